@@ -0,0 +1,50 @@
+#version 410 core
+
+// three.vert with linear blend skinning: the bind-pose mesh and per-vertex
+// joints/weights are static, only the joint palette changes per frame.
+// Joints arrive as unsigned bytes, weights as unorm8 summing to exactly 1;
+// unused slots are joint 0 with weight 0.
+
+#define MAX_PALETTE_JOINTS 128
+
+layout(location = 0) in  vec3 a_Position;
+layout(location = 1) in  vec3 a_Normal;
+layout(location = 2) in  vec2 a_TexCoord;
+layout(location = 3) in  vec4 a_Joints;
+layout(location = 4) in  vec4 a_Weights;
+
+layout(location = 0) out vec3 v_Position;
+layout(location = 1) out vec3 v_Normal;
+layout(location = 2) out vec2 v_TexCoord;
+
+layout(std140) uniform PassConstants {
+    mat4  u_NormalTransform;
+    mat4  u_Model;
+    mat4  u_View;
+    mat4  u_Projection;
+    vec3  u_LightDirection;
+    vec3  u_LightColor;
+    vec3  u_ObjectColor;
+    float u_Ambient;
+    bool  u_HasTexCoord;
+    bool  u_Wireframe;
+    bool  u_Flat;
+};
+
+layout(std140) uniform SkinningPalette {
+    mat4 u_Joints[MAX_PALETTE_JOINTS];
+};
+
+void main() {
+    mat4 skin = a_Weights.x * u_Joints[int(a_Joints.x)]
+              + a_Weights.y * u_Joints[int(a_Joints.y)]
+              + a_Weights.z * u_Joints[int(a_Joints.z)]
+              + a_Weights.w * u_Joints[int(a_Joints.w)];
+    vec4 position = skin * vec4(a_Position, 1.0);
+    vec3 normal   = mat3(skin) * a_Normal;
+
+    v_Position  = (u_Model * position).xyz;
+    v_Normal    = mat3(u_NormalTransform) * normal;
+    v_TexCoord  = a_TexCoord;
+    gl_Position = u_Projection * u_View * vec4(v_Position, 1.0);
+}
@@ -12,6 +12,7 @@ namespace VCX::Engine::GL {
         gl_using(_vao);
         for (auto const & attrBlock : _layout.AttribBlocks) {
             _vbos.emplace_back();
+            _vboCapacities.push_back(0);
             auto const useVbo { _vbos.back().Use() };
             for (auto const & attr : attrBlock.Attributes) {
                 glVertexAttribPointer(
@@ -25,7 +26,15 @@ namespace VCX::Engine::GL {
     void UniqueRenderItem::UpdateVertexBuffer(char const * const name, std::span<std::byte const> const & data) {
         auto const idx = _layout.GetIndexByName(name);
         auto const useVbo { _vbos[idx].Use() };
-        glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GLenum(_layout.AttribBlocks[idx].Frequency));
+        auto const usage = GLenum(_layout.AttribBlocks[idx].Frequency);
+        if (data.size() > _vboCapacities[idx]) {
+            glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), usage);
+            _vboCapacities[idx] = data.size();
+        } else if (! data.empty()) {
+            // orphan stream buffers so the driver need not wait for draws still reading the old contents
+            if (usage == GL_STREAM_DRAW) glBufferData(GL_ARRAY_BUFFER, _vboCapacities[idx], nullptr, usage);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, data.size(), data.data());
+        }
         _vtxCount = data.size() / _layout.AttribBlocks[idx].Stride;
     }
 
@@ -50,7 +59,12 @@ namespace VCX::Engine::GL {
 
     void UniqueIndexedRenderItem::UpdateElementBuffer(std::span<std::uint32_t const> const & data) {
         gl_using(_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.size_bytes(), data.data(), GL_STATIC_DRAW);
+        if (data.size_bytes() > _idxCapacity) {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.size_bytes(), data.data(), GL_STATIC_DRAW);
+            _idxCapacity = data.size_bytes();
+        } else if (! data.empty()) {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, data.size_bytes(), data.data());
+        }
         _idxCount = data.size();
     }
 
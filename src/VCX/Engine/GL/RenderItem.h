@@ -26,6 +26,8 @@ namespace VCX::Engine::GL {
             VertexLayout  const & layout,
             PrimitiveType const   primitiveType = PrimitiveType::Triangles);
 
+        // reuses the existing storage when it is large enough (orphaned first for Stream buffers),
+        // only reallocates when the data grows
         void UpdateVertexBuffer(char const * const name, std::span<std::byte const> const & data);
 
         void Draw(
@@ -40,6 +42,7 @@ namespace VCX::Engine::GL {
 
         UniqueVertexArray              _vao;
         std::vector<UniqueArrayBuffer> _vbos;
+        std::vector<std::size_t>       _vboCapacities;
 
         std::size_t                    _vtxCount = 0;
     };
@@ -61,6 +64,7 @@ namespace VCX::Engine::GL {
 
     private:
         UniqueElementArrayBuffer _ebo;
-        std::size_t              _idxCount;
+        std::size_t              _idxCount    = 0;
+        std::size_t              _idxCapacity = 0;
     };
 } // namespace VCX::Engine::GL
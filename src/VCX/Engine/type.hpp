@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <type_traits>
 
@@ -30,6 +31,13 @@ namespace VCX::Engine {
         using size = std::integral_constant<std::size_t, N * M>;
     };
 
+    template<typename T, std::size_t N>
+        requires std::is_arithmetic_v<T>
+    struct glm_unpack<std::array<T, N>> {
+        using type = T;
+        using size = std::integral_constant<std::size_t, N>;
+    };
+
     template<typename T>
     using glm_type_of = typename glm_unpack<T>::type;
 
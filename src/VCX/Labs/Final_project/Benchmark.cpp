@@ -0,0 +1,138 @@
+#include "Labs/Final_project/Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Labs/Final_project/MotionMatching.h"
+#include "Labs/Final_project/ReadBVH.h"
+
+namespace VCX::Labs::Final {
+namespace {
+    template<typename Func>
+    double MeasureMs(int iterations, Func && func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) func();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count() / std::max(1, iterations);
+    }
+} // namespace
+
+    BenchmarkResult BenchmarkBVHParser(const std::string & path, int iterations) {
+        BenchmarkResult result;
+        result.name = "BVH Parser";
+        result.iterations = iterations;
+
+        HumanDS human;
+        BVHClip baseline;
+        BVHClip optimized;
+        if (! LoadBVHStream(path, human, baseline) || ! LoadBVH(path, human, optimized)) return result;
+        result.identical = baseline.frames == optimized.frames && baseline.frame_count == optimized.frame_count;
+
+        result.baselineMs = MeasureMs(iterations, [&]() {
+            HumanDS h;
+            BVHClip c;
+            LoadBVHStream(path, h, c);
+        });
+        result.optimizedMs = MeasureMs(iterations, [&]() {
+            HumanDS h;
+            BVHClip c;
+            LoadBVH(path, h, c);
+        });
+        result.valid = true;
+        return result;
+    }
+
+    BenchmarkResult BenchmarkFeatureSearch(const std::string & path, int replicas, int iterations) {
+        BenchmarkResult result;
+        result.name = "Feature Search";
+        result.iterations = iterations;
+
+        Motion motion;
+        if (! LoadBVHAsMotion(path, motion)) return result;
+        std::vector<Motion> clips(std::max(1, replicas), motion);
+        MatchingDatabase db;
+        if (! db.Build(clips)) return result;
+
+        //查询取自库中的帧 并扰动轨迹段 模拟运行时的输入变化
+        constexpr std::size_t D = MatchingDatabase::c_FeatureDim;
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<std::size_t> pick(0, db.EntryCount() - 1);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        std::vector<float> queries(static_cast<std::size_t>(std::max(1, iterations)) * D);
+        for (std::size_t q = 0; q < queries.size() / D; q++) {
+            auto f = db.Features(pick(rng));
+            std::copy(f.begin(), f.end(), queries.begin() + q * D);
+            for (std::size_t d = MatchingDatabase::c_TrajectoryOffset; d < D; d++) queries[q * D + d] += noise(rng);
+        }
+
+        std::vector<std::ptrdiff_t> baseline(queries.size() / D);
+        std::vector<std::ptrdiff_t> optimized(queries.size() / D);
+        auto run = [&](auto && search, std::vector<std::ptrdiff_t> & out) {
+            for (std::size_t q = 0; q < out.size(); q++) {
+                float best_cost = std::numeric_limits<float>::max();
+                out[q] = search(std::span<const float>(queries.data() + q * D, D), best_cost);
+            }
+        };
+        const double count = static_cast<double>(baseline.size());
+        result.baselineMs = MeasureMs(1, [&]() { run([&](auto q, float & c) { return db.SearchBruteForce(q, c); }, baseline); }) / count;
+        result.optimizedMs = MeasureMs(1, [&]() { run([&](auto q, float & c) { return db.Search(q, c); }, optimized); }) / count;
+        result.identical = baseline == optimized;
+        result.valid = true;
+        return result;
+    }
+
+    BenchmarkResult BenchmarkSkinning(
+        Engine::SurfaceMesh const &          bindMesh,
+        Motion const &                       motion,
+        float                                skeletonScale,
+        Skinning::LinearBlendKernel const &  kernel,
+        std::span<const Skinning::Influence> weights,
+        std::span<const glm::mat4>           invBind,
+        int                                  iterations) {
+        BenchmarkResult result;
+        result.name = "LBS vs DQS";
+        result.iterations = iterations;
+        if (! kernel.Ready() || kernel.VertexCount() != bindMesh.Positions.size() || weights.size() != bindMesh.Positions.size() || motion.FrameCount() == 0 || motion.JointCount() != invBind.size())
+            return result;
+
+        Skeleton pose;
+        std::vector<glm::mat4> skin_mats;
+        std::vector<Skinning::DualQuat> skin_dqs;
+        std::vector<glm::vec3> linear(bindMesh.Positions.size());
+        std::vector<glm::vec3> dual(bindMesh.Positions.size());
+
+        //绑定姿态下两种方法都应还原绑定网格
+        if (! motion.GetPose(0, pose)) return result;
+        Skinning::ComputeSkinningMatrices(pose, skeletonScale, invBind, skin_mats);
+        Skinning::ComputeSkinningDualQuats(pose, skeletonScale, invBind, skin_dqs);
+        if (! kernel.Apply(skin_mats, linear) || ! kernel.ApplyDualQuat(skin_dqs, dual)) return result;
+        float extent = 0.0f;
+        float error = 0.0f;
+        for (std::size_t v = 0; v < bindMesh.Positions.size(); v++) {
+            auto const & joints = weights[v].joints;
+            if (std::all_of(joints.begin(), joints.end(), [](int j) { return j < 0; })) continue;
+            extent = std::max(extent, glm::length(bindMesh.Positions[v]));
+            error = std::max({ error, glm::length(linear[v] - bindMesh.Positions[v]), glm::length(dual[v] - bindMesh.Positions[v]) });
+        }
+        result.identical = error <= 1e-4f * std::max(1.0f, extent);
+
+        std::size_t frame = 0;
+        result.baselineMs = MeasureMs(iterations, [&]() {
+            motion.GetPose(frame++ % motion.FrameCount(), pose);
+            Skinning::ComputeSkinningMatrices(pose, skeletonScale, invBind, skin_mats);
+            kernel.Apply(skin_mats, linear);
+        });
+        frame = 0;
+        result.optimizedMs = MeasureMs(iterations, [&]() {
+            motion.GetPose(frame++ % motion.FrameCount(), pose);
+            Skinning::ComputeSkinningDualQuats(pose, skeletonScale, invBind, skin_dqs);
+            kernel.ApplyDualQuat(skin_dqs, dual);
+        });
+        result.valid = true;
+        return result;
+    }
+}
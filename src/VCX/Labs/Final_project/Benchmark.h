@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include "Labs/Final_project/SkinningKernel.h"
+
+namespace VCX::Labs::Final {
+    //基准对比结果: 耗时均为单次迭代的平均毫秒数
+    struct BenchmarkResult {
+        std::string name;
+        double      baselineMs  = 0.0;
+        double      optimizedMs = 0.0;
+        int         iterations  = 0;
+        bool        identical   = false;  //两条路径的输出是否一致
+        bool        valid       = false;
+
+        double Speedup() const { return optimizedMs > 0.0 ? baselineMs / optimizedMs : 0.0; }
+    };
+
+    //LoadBVHStream(ifstream逐token) vs LoadBVH(整块读入 + from_chars + 多线程)
+    BenchmarkResult BenchmarkBVHParser(const std::string & path, int iterations = 5);
+
+    //动作匹配检索: 逐帧穷举 vs FeatureIndex包围盒剪枝 数据库由该片段复制replicas份组成 iterations为查询次数
+    BenchmarkResult BenchmarkFeatureSearch(const std::string & path, int replicas = 10, int iterations = 1000);
+
+    //CPU蒙皮: 线性混合 vs 对偶四元数 依次播放motion的各帧 均含每帧的关节变换计算 不含法线重算
+    //两者结果本就不同 identical表示二者在第0帧(绑定姿态)都还原了绑定网格
+    //没有任何影响关节的顶点两种方法都输出原点 不参与该检查 weights为kernel准备时使用的权重
+    BenchmarkResult BenchmarkSkinning(
+        Engine::SurfaceMesh const &          bindMesh,
+        Motion const &                       motion,
+        float                                skeletonScale,
+        Skinning::LinearBlendKernel const &  kernel,
+        std::span<const Skinning::Influence> weights,
+        std::span<const glm::mat4>           invBind,
+        int                                  iterations = 100);
+}
@@ -0,0 +1,83 @@
+#include "Labs/Final_project/CapsuleGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace VCX::Labs::Final::Skinning {
+    void CapsuleGrid::Clear() {
+        _origin      = glm::vec3(0.0f);
+        _invCellSize = 0.0f;
+        _dims        = glm::ivec3(0);
+        _offsets.clear();
+        _items.clear();
+    }
+
+    glm::ivec3 CapsuleGrid::CellOf(glm::vec3 const & p) const {
+        glm::vec3 scaled = (p - _origin) * _invCellSize;
+        glm::ivec3 cell;
+        for (int k = 0; k < 3; k++)
+            cell[k] = static_cast<int>(std::clamp(std::floor(scaled[k]), 0.0f, static_cast<float>(_dims[k] - 1)));
+        return cell;
+    }
+
+    void CapsuleGrid::Build(std::span<const glm::vec3> points, std::span<const Capsule> capsules) {
+        Clear();
+        if (points.empty() || capsules.empty()) return;
+
+        glm::vec3 lo = points[0];
+        glm::vec3 hi = points[0];
+        for (auto const & p : points) {
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        float extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z });
+        float radius = 0.0f;
+        for (auto const & c : capsules) radius = std::max(radius, c.radius);
+        //半径很小时限制格子总数 半径为0时只按范围划分
+        float cell = std::max(radius, extent / static_cast<float>(c_MaxCellsPerAxis));
+        if (! (cell > 0.0f)) cell = 1.0f;
+        //外扩量留出余量 吸收距离计算的舍入误差
+        const float margin = 1e-4f * radius + 1e-5f * std::max(extent, 1.0f);
+
+        _origin      = lo;
+        _invCellSize = 1.0f / cell;
+        for (int k = 0; k < 3; k++)
+            _dims[k] = std::clamp(static_cast<int>(std::floor((hi[k] - lo[k]) * _invCellSize)) + 1, 1, c_MaxCellsPerAxis);
+
+        std::vector<std::pair<glm::ivec3, glm::ivec3>> spans(capsules.size(), { glm::ivec3(0), glm::ivec3(-1) });
+        for (std::size_t i = 0; i < capsules.size(); i++) {
+            auto const & c = capsules[i];
+            if (c.radius < 0.0f) continue;
+            glm::vec3 r(c.radius + margin);
+            glm::vec3 cmin = glm::min(c.a, c.b) - r;
+            glm::vec3 cmax = glm::max(c.a, c.b) + r;
+            if (glm::any(glm::lessThan(cmax, lo)) || glm::any(glm::greaterThan(cmin, hi))) continue;
+            spans[i] = { CellOf(cmin), CellOf(cmax) };
+        }
+
+        //两遍计数填充 按胶囊序号顺序写入 每个格子内的序号自然升序
+        std::size_t cellCount = static_cast<std::size_t>(_dims.x) * _dims.y * _dims.z;
+        _offsets.assign(cellCount + 1, 0);
+        auto visit = [&](auto && func) {
+            for (std::size_t i = 0; i < spans.size(); i++) {
+                auto const & [first, last] = spans[i];
+                for (int z = first.z; z <= last.z; z++)
+                    for (int y = first.y; y <= last.y; y++)
+                        for (int x = first.x; x <= last.x; x++)
+                            func(CellIndex({ x, y, z }), static_cast<std::uint32_t>(i));
+            }
+        };
+        visit([&](std::size_t cellIndex, std::uint32_t) { _offsets[cellIndex + 1]++; });
+        for (std::size_t i = 0; i < cellCount; i++) _offsets[i + 1] += _offsets[i];
+        _items.resize(_offsets[cellCount]);
+        std::vector<std::uint32_t> cursor(_offsets.begin(), _offsets.end() - 1);
+        visit([&](std::size_t cellIndex, std::uint32_t item) { _items[cursor[cellIndex]++] = item; });
+    }
+
+    std::span<const std::uint32_t> CapsuleGrid::Query(glm::vec3 const & p) const {
+        if (_items.empty()) return {};
+        std::size_t cellIndex = CellIndex(CellOf(p));
+        return { _items.data() + _offsets[cellIndex], _offsets[cellIndex + 1] - _offsets[cellIndex] };
+    }
+}
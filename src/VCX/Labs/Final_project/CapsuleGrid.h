@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VCX::Labs::Final::Skinning {
+    //线段ab及其半径 radius小于0的胶囊不参与索引 a == b时退化为球
+    struct Capsule {
+        glm::vec3 a;
+        glm::vec3 b;
+        float     radius;
+    };
+
+    //覆盖查询点包围盒的均匀网格 胶囊按外扩radius后的包围盒登记到所有相交的格子
+    //格子边长取最大半径 每轴最多c_MaxCellsPerAxis个格子 查询只返回候选 精确判断由调用方完成
+    class CapsuleGrid {
+    public:
+        static constexpr int c_MaxCellsPerAxis = 64;
+
+        //points为之后会被查询的点 用于确定网格范围
+        void Build(std::span<const glm::vec3> points, std::span<const Capsule> capsules);
+        void Clear();
+
+        bool Empty() const { return _items.empty(); }
+
+        //与p距离不超过radius的胶囊必在返回值中 序号按升序排列 p需位于Build时points的包围盒内
+        std::span<const std::uint32_t> Query(glm::vec3 const & p) const;
+
+    private:
+        glm::ivec3  CellOf(glm::vec3 const & p) const;
+        std::size_t CellIndex(glm::ivec3 const & cell) const { return (static_cast<std::size_t>(cell.z) * _dims.y + cell.y) * _dims.x + cell.x; }
+
+        glm::vec3                  _origin { 0.0f };
+        float                      _invCellSize { 0.0f };
+        glm::ivec3                 _dims { 0 };
+        std::vector<std::uint32_t> _offsets;  //CSR 格子 -> _items区间
+        std::vector<std::uint32_t> _items;
+    };
+}
@@ -183,11 +183,14 @@ namespace {
         if (ImGui::Button("Load")) {
             Motion loaded;
             if (LoadBVHAsMotion(_pathBuffer.data(), loaded)) {
+                //播放中载入时平滑过渡到新片段 否则直接切换并暂停
+                bool transition = _loaded && _play;
                 _motion = std::move(loaded);
                 _loaded = _motion.FrameCount() > 0;
-                _frameIndex = 0;
-                _timeAccum = 0.0f;
-                _play = false;
+                _player.Play(_motion, transition && ! _inertialize ? _fadeDuration : 0.0f);
+                if (transition && _inertialize) _inertializer.Transition(_motion, 0.0f);
+                else _inertializer.Reset();
+                _play = transition && _loaded;
                 if (_loaded) ImGui::Text("鍔犺浇鎴愬姛");
             } else {
                 _loaded = false;
@@ -199,14 +202,52 @@ namespace {
         }
         ImGui::SameLine();
         if (ImGui::Button("Reset")) ResetSystem();
+        if (ImGui::Button("Add Clip")) {
+            Motion clip;
+            if (LoadBVHAsMotion(_pathBuffer.data(), clip) && clip.FrameCount() > 0) {
+                _clips.push_back(std::move(clip));
+                _database.Build(_clips);
+                _controller.Reset(_database);
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Clips")) {
+            _clips.clear();
+            _database.Clear();
+            _controller.Reset(_database);
+            _matching = false;
+        }
+        ImGui::Text("Clips: %zu  Entries: %zu", _database.ClipCount(), _database.EntryCount());
+        if (_database.Ranges().empty()) ImGui::BeginDisabled();
+        if (ImGui::Checkbox("Motion Matching (WASD)", &_matching)) _controller.Reset(_database);
+        if (_database.Ranges().empty()) ImGui::EndDisabled();
+        if (_matching) {
+            ImGui::SliderInt("Search Interval", &_controller.searchInterval, 1, 60);
+            ImGui::SliderFloat("Jump Halflife", &_controller.transitionHalflife, 0.0f, 0.5f, "%.2f s");
+            ImGui::SliderFloat("Speed", &_speed, 0.0f, 3.0f, "%.2f");
+            ImGui::Text("Entry: %zu  Searches: %zu", _controller.CurrentEntry(), _controller.SearchCount());
+        }
+        if (ImGui::Button("Benchmark Parser")) _benchmark = BenchmarkBVHParser(_pathBuffer.data());
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Search")) _benchmark = BenchmarkFeatureSearch(_pathBuffer.data());
+        if (_benchmark.valid) {
+            ImGui::Text("%s: %.2f ms -> %.2f ms (x%.1f)%s", _benchmark.name.c_str(), _benchmark.baselineMs, _benchmark.optimizedMs, _benchmark.Speedup(), _benchmark.identical ? "" : " [mismatch]");
+        }
 
         ImGui::SliderFloat("Scale", &_scale, 0.001f, 0.1f, "%.3f");
         ImGui::Checkbox("Show Axis", &_showAxis);
+        ImGui::Checkbox("Inertialize Transitions", &_inertialize);
+        if (_inertialize) ImGui::SliderFloat("Transition Halflife", &_transitionHalflife, 0.01f, 0.5f, "%.2f s");
+        else ImGui::SliderFloat("Crossfade", &_fadeDuration, 0.0f, 1.0f, "%.2f s");
         if (_loaded && _motion.FrameCount() > 0) {
-            int frame = static_cast<int>(_frameIndex);
-            ImGui::SliderInt("Frame", &frame, 0, static_cast<int>(_motion.FrameCount() - 1));
-            _frameIndex = static_cast<std::size_t>(frame);
-            ImGui::Text("Frames: %zu", _motion.FrameCount());
+            float time = _player.Time();
+            if (ImGui::SliderFloat("Time", &time, 0.0f, PoseSampler::Duration(_motion), "%.3f s")) {
+                //播放中拖动视为跳转 暂停时直接显示所选时刻
+                _player.SetTime(time);
+                if (_play) _inertializer.Transition(_motion, time);
+                else _inertializer.Reset();
+            }
+            ImGui::Text("Frames: %zu  Frame: %zu", _motion.FrameCount(), _player.Frame());
         } else {
             ImGui::Text("Frames: 0");
         }
@@ -224,17 +265,16 @@ namespace {
         glLineWidth(0.5f);
         glPointSize(4.f);
 
-        if (_loaded && _motion.FrameCount() > 0) {
-            if (_play) {
-                _timeAccum += Engine::GetDeltaTime();
-                float frame_step = (_motion.frame_time > 0.0f) ? _motion.frame_time : (1.0f / 30.0f);
-                while (_timeAccum >= frame_step) {
-                    _frameIndex = (_frameIndex + 1) % _motion.FrameCount();
-                    _timeAccum -= frame_step;
-                }
-            }
-            auto joint_pos = _motion.GetJointPositions(_frameIndex);
-            auto segments = _motion.frames[_frameIndex].GetSegments();
+        if (_matching && ! _database.Ranges().empty()) {
+            UpdateMatching(Engine::GetDeltaTime());
+        } else if (_loaded && _motion.FrameCount() > 0) {
+            //按连续时刻取样 显示刷新率高于片段帧率时在相邻帧之间插值 淡入期间与旧片段混合
+            float dt = _play ? Engine::GetDeltaTime() : 0.0f;
+            _player.Advance(dt);
+            _player.Evaluate(_pose);
+            _inertializer.Update(_pose, _transitionHalflife, dt);
+            auto joint_pos = _pose.global_trans;
+            auto segments = _pose.GetSegments();
             for (auto & p : joint_pos) p *= _scale;
             for (auto & p : segments) p *= _scale;
             BuildBySegments(segments);
@@ -262,12 +302,42 @@ namespace {
     }
 
     void CaseFinal::OnProcessInput(ImVec2 const & pos) {
+        //动作匹配时WASD用于控制角色 不再平移相机
+        _cameraManager.EnablePan = ! _matching;
         _cameraManager.ProcessInput(_camera, pos);
+        _input = glm::vec2(0.0f);
+        if (! _matching || ! ImGui::IsItemFocused()) return;
+        if (ImGui::IsKeyDown(ImGuiKey_W) || ImGui::IsKeyDown(ImGuiKey_UpArrow)) _input.y += 1.0f;
+        if (ImGui::IsKeyDown(ImGuiKey_S) || ImGui::IsKeyDown(ImGuiKey_DownArrow)) _input.y -= 1.0f;
+        if (ImGui::IsKeyDown(ImGuiKey_A) || ImGui::IsKeyDown(ImGuiKey_LeftArrow)) _input.x -= 1.0f;
+        if (ImGui::IsKeyDown(ImGuiKey_D) || ImGui::IsKeyDown(ImGuiKey_RightArrow)) _input.x += 1.0f;
+    }
+
+    void CaseFinal::UpdateMatching(float dt) {
+        //输入方向取相机在水平面上的前方/右方
+        glm::vec3 forward = _camera.Target - _camera.Eye;
+        forward.y = 0.0f;
+        forward = glm::length(forward) > 1e-6f ? glm::normalize(forward) : glm::vec3(0.0f, 0.0f, -1.0f);
+        glm::vec3 right = glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::vec3 desired = forward * _input.y + right * _input.x;
+        if (glm::length(desired) > 1.0f) desired = glm::normalize(desired);
+        desired *= _speed * _database.MeanSpeed();
+        _controller.Update(_database, _clips, desired, dt);
+
+        //以角色为中心绘制 同时画出预测的未来轨迹
+        glm::vec3 center = _controller.RootPosition();
+        auto joint_pos = _controller.Pose().global_trans;
+        auto segments = _controller.Pose().GetSegments();
+        for (auto & p : joint_pos) p = (p - center) * _scale;
+        for (auto & p : segments) p = (p - center) * _scale;
+        for (auto const & p : _controller.Trajectory()) joint_pos.push_back((p - center) * _scale);
+        BuildBySegments(segments);
+        BackGround.UpdatePoints(joint_pos);
     }
 
     void CaseFinal::ResetSystem() {
-        _frameIndex = 0;
-        _timeAccum = 0.0f;
+        _player.SetTime(0.0f);
+        _inertializer.Reset();
         _play = false;
     }
 } // namespace VCX::Labs::Final
@@ -8,6 +8,10 @@
 #include "Labs/Common/OrbitCameraManager.h"
 #include "ReadBVH.h"
 #include "HumanDS.h"
+#include "Benchmark.h"
+#include "MotionMatching.h"
+#include "Inertializer.h"
+#include "PoseBlend.h"
 #include <array>
 #include <string>
 
@@ -55,6 +59,7 @@ namespace VCX::Labs::Final {
     private:
         void                                BuildBySegments(const std::vector<glm::vec3> & segment_points);
         void                                ResetSystem();
+        void                                UpdateMatching(float dt);
 
     private:
         Engine::GL::UniqueProgram           _program;
@@ -66,13 +71,25 @@ namespace VCX::Labs::Final {
         bool                                _showAxis { true };
         bool                                _browseFailed { false };
         unsigned long                       _browseError { 0 };
-        float                               _timeAccum { 0.0f };
-        std::size_t                         _frameIndex { 0 };
+        bool                                _inertialize { true };    //播放中切换片段时用惯性化 否则交叉淡入淡出
+        float                               _fadeDuration { 0.25f };  //播放中载入新片段时的淡入时长(秒)
+        float                               _transitionHalflife { 0.1f };
         float                               _scale { 0.025f };
 
         BackGroundRender                    BackGround;
         std::vector<BoxRenderer>            arms; // for render the arm
         Motion                              _motion;
+        Skeleton                            _pose;
+        CrossfadePlayer                     _player;
+        Inertializer                        _inertializer;  //片段切换与拖动时刻时消除姿态突变
+        BenchmarkResult                     _benchmark;
         std::array<char, 260>               _pathBuffer {};
+
+        std::vector<Motion>                 _clips;     // motion matching database clips
+        MatchingDatabase                    _database;
+        MotionMatchingController            _controller;
+        bool                                _matching { false };
+        glm::vec2                           _input { 0.0f };
+        float                               _speed { 1.0f };
     };
 } // namespace VCX::Labs::Final
@@ -1,6 +1,8 @@
 ﻿
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <filesystem>
 #include <limits>
 #include <span>
 #include <string>
@@ -111,6 +113,11 @@ namespace {
         std::copy_n(default_path.begin(), std::min(default_path.size(), _bvhPath.size() - 1), _bvhPath.begin());
         _bvhPath[_bvhPath.size() - 1] = '\0';
 
+        //权重缓存放在系统临时目录 取不到时不启用缓存
+        std::error_code ec;
+        auto temp_dir = std::filesystem::temp_directory_path(ec);
+        if (! ec) _bindJob.SetCacheDirectory(temp_dir / "vcx-skinning");
+
         ResetModel();
     }
 
@@ -154,11 +161,15 @@ namespace {
             Motion loaded;
             if (LoadBVHAsMotion(_bvhPath.data(), loaded)) {
                 _motion = std::move(loaded);
+                _segmentIndices = _motion.skeleton.GetSegmentIndices();
                 _loaded = _motion.FrameCount() > 0;
-                _frameIndex = 0;
-                _timeAccum = 0.0f;
+                _time = 0.0f;
+                _sampler.Reset();
+                _inertializer.Reset();
                 _play = false;
                 _weightsDirty = true;
+                ClearWeights();  //旧权重引用的关节与新骨骼不对应
+                UploadModel();
             } else {
                 _loaded = false;
                 _skeletonSegments.clear();
@@ -169,16 +180,23 @@ namespace {
             if (_loaded) _play = ! _play;
         }
         if (_loaded && _motion.FrameCount() > 0) {
-            int frame = static_cast<int>(_frameIndex);
-            ImGui::SliderInt("Frame", &frame, 0, static_cast<int>(_motion.FrameCount() - 1));
-            _frameIndex = static_cast<std::size_t>(frame);
-            ImGui::Text("Frames: %zu", _motion.FrameCount());
+            if (ImGui::SliderFloat("Time", &_time, 0.0f, PoseSampler::Duration(_motion), "%.3f s")) {
+                //播放中拖动视为跳转 暂停时直接显示所选时刻
+                if (_play) _inertializer.Transition(_motion, _time);
+                else _inertializer.Reset();
+            }
+            ImGui::Text("Frames: %zu  Frame: %zu", _motion.FrameCount(), _sampler.Frame());
         } else {
             ImGui::Text("Frames: 0");
         }
         if (ImGui::SliderFloat("Skeleton Scale", &_skeletonScale, 0.001f, 0.1f, "%.3f")) {
             _weightsDirty = true;
         }
+        int diffusion = static_cast<int>(_diffusion);
+        if (ImGui::Combo("Heat Diffusion", &diffusion, "Jacobi\0Sparse Cholesky\0")) {
+            _diffusion = static_cast<Skinning::DiffusionMethod>(diffusion);
+            _weightsDirty = true;
+        }
         if (ImGui::SliderInt("Heat Iterations", &_heatIterations, 1, 100)) {
             _weightsDirty = true;
         }
@@ -191,6 +209,49 @@ namespace {
         if (ImGui::SliderInt("Component Max Joints", &_componentMaxJoints, 1, 8)) {
             _weightsDirty = true;
         }
+        std::string stages;
+        for (int s = 0; s < static_cast<int>(Skinning::BindStage::Count); s++) {
+            if (! _bindJob.Executed(static_cast<Skinning::BindStage>(s))) continue;
+            if (! stages.empty()) stages += ", ";
+            stages += Skinning::BindStageName(static_cast<Skinning::BindStage>(s));
+        }
+        if (_bindJob.FromCache()) stages = "cache";
+        if (_bindJob.SparseFallback()) stages += " (sparse factorization failed, used Jacobi)";
+        ImGui::TextWrapped("Last Bind: %s", stages.empty() ? "-" : stages.c_str());
+        if (_bindJob.Busy())
+            ImGui::ProgressBar(_bindJob.Progress(), ImVec2(-1.0f, 0.0f), Skinning::BindStageName(_bindJob.Stage()));
+        bool gpu_available = ! _invBind.empty() && _invBind.size() <= c_MaxPaletteJoints;
+        if (! gpu_available) ImGui::BeginDisabled();
+        if (ImGui::Checkbox("GPU Skinning", &_gpuSkinning)) UploadModel();
+        if (! gpu_available) ImGui::EndDisabled();
+        //GPU蒙皮只实现了线性混合 此时显示实际使用的方法 关闭GPU蒙皮后恢复之前的选择
+        bool gpu_skinned = _modelObject.IsSkinned();
+        if (gpu_skinned) ImGui::BeginDisabled();
+        int method = static_cast<int>(gpu_skinned ? Skinning::SkinningMethod::Linear : _skinningMethod);
+        if (ImGui::Combo("Skinning Method", &method, "Linear Blend\0Dual Quaternion\0")) {
+            _skinningMethod = static_cast<Skinning::SkinningMethod>(method);
+            _lastTime = -1.0f;
+        }
+        if (gpu_skinned) ImGui::EndDisabled();
+        if (gpu_skinned && _skinningMethod == Skinning::SkinningMethod::DualQuaternion)
+            ImGui::TextDisabled("Dual Quaternion is CPU-only");
+        int simd = static_cast<int>(_kernel.Level());
+        if (ImGui::Combo("SIMD", &simd, "Scalar\0SSE2\0AVX2\0")) {
+            _kernel.SetLevel(static_cast<Skinning::SimdLevel>(simd));
+            _lastTime = -1.0f;
+        }
+        int workers = static_cast<int>(_kernel.WorkerCount());
+        if (ImGui::SliderInt("Skinning Threads (0 = auto)", &workers, 0, 32)) {
+            _kernel.SetWorkerCount(static_cast<unsigned>(workers));
+            _lastTime = -1.0f;
+        }
+        if (! _kernel.Ready()) ImGui::BeginDisabled();
+        if (ImGui::Button("Benchmark LBS vs DQS"))
+            _benchmark = BenchmarkSkinning(_bindMesh, _motion, _boundScale, _kernel, _weights, _invBind);
+        if (! _kernel.Ready()) ImGui::EndDisabled();
+        if (_benchmark.valid) {
+            ImGui::Text("%s: %.2f ms -> %.2f ms (x%.2f)%s", _benchmark.name.c_str(), _benchmark.baselineMs, _benchmark.optimizedMs, _benchmark.Speedup(), _benchmark.identical ? "" : " [mismatch]");
+        }
         ImGui::Spacing();
 
         Viewer::SetupRenderOptionsUI(_options, _cameraManager);
@@ -203,34 +264,64 @@ namespace {
         }
         if (_loaded && _weightsDirty) {
             Skinning::Options options;
+            options.diffusion = _diffusion;
             options.heatIterations = _heatIterations;
             options.heatLambda = _heatLambda;
             options.heatAnchorRadius = _heatAnchorRadius;
             options.componentMaxJoints = _componentMaxJoints;
-            UpdateAlignedMesh();
-            _weightsDirty = !Skinning::BuildSkinningData(_bindMesh, _motion, _skeletonScale, options, _weights, _invBind);
-            _lastFrameIndex = static_cast<std::size_t>(-1);
+            options.workerCount = _kernel.WorkerCount();
+            //绑定在后台按阶段缓存执行 拖动滑条时旧请求被中止 新权重到达前继续使用当前权重
+            Skeleton bind_pose;
+            if (_motion.GetPose(0, bind_pose)) {
+                UpdateAlignedMesh(_pendingMesh);
+                _pendingScale = _skeletonScale;
+                _bindJob.Start(_pendingMesh, bind_pose, _pendingScale, options);
+            }
+            _weightsDirty = false;
+        }
+        if (_bindJob.TakeResult(_weights, _invBind)) {
+            _bindMesh = std::move(_pendingMesh);
+            _boundScale = _pendingScale;
+            _skinnedPositions.resize(_bindMesh.Positions.size());
+            _skinnedNormals.resize(_bindMesh.Positions.size());
+            if (_weights.empty()) _kernel.Clear();
+            else _kernel.Prepare(_bindMesh.Positions, _weights, _bindMesh.Indices);
+            UploadModel();
         }
         if (_loaded && _motion.FrameCount() > 0) {
-            if (_play && _motion.frame_time > 0.0f) {
-                _timeAccum += ImGui::GetIO().DeltaTime;
-                while (_timeAccum >= _motion.frame_time) {
-                    _timeAccum -= _motion.frame_time;
-                    _frameIndex = (_frameIndex + 1) % _motion.FrameCount();
-                }
+            float dt = _play ? ImGui::GetIO().DeltaTime : 0.0f;
+            if (_play) {
+                float duration = PoseSampler::Duration(_motion);
+                _time += dt;
+                _time = duration > 0.0f ? std::fmod(_time, duration) : 0.0f;
             }
-            if (_frameIndex != _lastFrameIndex) {
-                if (Skinning::ApplySkinning(_bindMesh, _motion, _frameIndex, _skeletonScale, _weights, _invBind, _skinnedMesh))
-                    _modelObject.ReplaceMesh(_skinnedMesh);
-                _skeletonSegments = _motion.frames[_frameIndex].GetSegments();
-                for (auto & p : _skeletonSegments) p *= _skeletonScale;
-                _lastFrameIndex = _frameIndex;
+            //按连续时刻插值取样 播放时每个显示帧都重新蒙皮 暂停时时刻不变则跳过
+            //逐帧路径只写入预先分配的缓冲 不复制绑定网格 也没有堆分配
+            if (_time != _lastTime) {
+                _sampler.Sample(_motion, _time, _pose);
+                _inertializer.Update(_pose, _transitionHalflife, dt);
+                if (_modelObject.IsSkinned())
+                    Skinning::ComputeSkinningMatrices(_pose, _boundScale, _invBind, _skinMats);
+                else if (Skinning::ApplySkinning(_pose, _boundScale, _kernel, _invBind, _bindMesh.Indices, _skinningMethod, _skinScratch, _skinnedPositions, _skinnedNormals)
+                    && ! _modelObject.UpdatePositionsNormals(_skinnedPositions, _skinnedNormals)) {
+                    Engine::SurfaceMesh mesh = _bindMesh;
+                    mesh.Positions = _skinnedPositions;
+                    mesh.Normals = _skinnedNormals;
+                    _modelObject.ReplaceMesh(mesh, true);
+                }
+                //骨骼与网格使用同一尺度 新尺度的绑定完成前两者都保持旧尺度
+                _skeletonSegments.resize(_segmentIndices.size() * 2);
+                for (std::size_t i = 0; i < _segmentIndices.size(); i++) {
+                    _skeletonSegments[2 * i]     = _pose.global_trans[_segmentIndices[i].first] * _boundScale;
+                    _skeletonSegments[2 * i + 1] = _pose.global_trans[_segmentIndices[i].second] * _boundScale;
+                }
+                _lastTime = _time;
             }
         }
         std::span<glm::vec3 const> skeleton_lines;
         if (! _skeletonSegments.empty())
             skeleton_lines = std::span<glm::vec3 const>(_skeletonSegments);
-        return _viewer.Render(_options, _modelObject, _camera, _cameraManager, desiredSize, skeleton_lines);
+        return _viewer.Render(_options, _modelObject, _camera, _cameraManager, desiredSize, skeleton_lines, _skinMats);
     }
 
     void CaseSkinning::OnProcessInput(ImVec2 const & pos) {
@@ -242,30 +333,49 @@ namespace {
             _sourceMesh = _customMesh;
         else
             _sourceMesh = GetModelMesh(_modelIdx);
-        UpdateAlignedMesh();
-        _skinnedMesh = _bindMesh;
+        ClearWeights();
+        UpdateAlignedMesh(_bindMesh);
         _modelObject.ReplaceMesh(_bindMesh);
         _skeletonSegments.clear();
         _weightsDirty = true;
-        _frameIndex = 0;
-        _lastFrameIndex = static_cast<std::size_t>(-1);
+        _time = 0.0f;
+        _lastTime = -1.0f;
+    }
+
+    void CaseSkinning::ClearWeights() {
+        _bindJob.Cancel();
+        _weights.clear();
+        _invBind.clear();
+        _skinMats.clear();
+        _kernel.Clear();
+    }
+
+    //GPU蒙皮时只上传一次绑定网格与权重 之后每帧只更新关节矩阵
+    void CaseSkinning::UploadModel() {
+        _lastTime = -1.0f;
+        bool ready = ! _weights.empty() && _weights.size() == _bindMesh.Positions.size();
+        std::vector<Skinning::PackedInfluence8> packed;
+        if (_gpuSkinning && ready && _invBind.size() <= c_MaxPaletteJoints && Skinning::PackInfluences(_weights, packed))
+            _modelObject.ReplaceSkinnedMesh(_bindMesh, packed);
+        else
+            _modelObject.ReplaceMesh(_bindMesh, true);
     }
 
-    void CaseSkinning::UpdateAlignedMesh() {
-        _bindMesh = _sourceMesh;
-        if (! _loaded || _motion.FrameCount() == 0 || _bindMesh.Positions.empty())
+    void CaseSkinning::UpdateAlignedMesh(Engine::SurfaceMesh & mesh) const {
+        mesh = _sourceMesh;
+        if (! _loaded || _motion.FrameCount() == 0 || mesh.Positions.empty())
             return;
 
-        auto joints = _motion.frames[0].DFSJoints();
-        if (joints.empty())
+        Skeleton pose;
+        if (! _motion.GetPose(0, pose) || pose.JointCount() == 0)
             return;
 
         std::vector<glm::vec3> joint_positions;
-        joint_positions.reserve(joints.size());
-        for (auto const & j : joints)
-            joint_positions.push_back(j->get_globaltrans() * _skeletonScale);
+        joint_positions.reserve(pose.JointCount());
+        for (auto const & p : pose.global_trans)
+            joint_positions.push_back(p * _skeletonScale);
 
-        auto mesh_aabb = ComputeAABB(_bindMesh.Positions);
+        auto mesh_aabb = ComputeAABB(mesh.Positions);
         auto skel_aabb = ComputeAABB(joint_positions);
 
         float mesh_height = HeightFromAABB(mesh_aabb);
@@ -275,9 +385,9 @@ namespace {
 
         float scale = skel_height / mesh_height;
         glm::vec3 mesh_center = CenterFromAABB(mesh_aabb);
-        glm::vec3 root_pos = joints[0]->get_globaltrans() * _skeletonScale;
+        glm::vec3 root_pos = pose.global_trans[0] * _skeletonScale;
 
-        for (auto & p : _bindMesh.Positions) {
+        for (auto & p : mesh.Positions) {
             p = (p - mesh_center) * scale + root_pos;
         }
     }
@@ -4,7 +4,12 @@
 #include <vector>
 
 #include "ReadBVH.h"
+#include "Labs/Final_project/Benchmark.h"
+#include "Labs/Final_project/Inertializer.h"
+#include "Labs/Final_project/PoseSampler.h"
 #include "Labs/Final_project/Skinning.h"
+#include "Labs/Final_project/SkinningJob.h"
+#include "Labs/Final_project/SkinningKernel.h"
 #include "Labs/Final_project/Content.h"
 #include "Labs/Final_project/Viewer.h"
 #include "Labs/Common/OrbitCameraManager.h"
@@ -34,13 +39,17 @@ namespace VCX::Labs::Final {
         RenderOptions                         _options;
 
         Motion                                _motion;
+        Skeleton                              _pose;
+        PoseSampler                           _sampler;
+        Inertializer                          _inertializer;    //播放中拖动时刻时消除姿态突变
         bool                                  _loaded           { false };
         bool                                  _play             { false };
         bool                                  _weightsDirty     { true };
-        float                                 _timeAccum        { 0.0f };
-        std::size_t                           _frameIndex       { 0 };
-        std::size_t                           _lastFrameIndex   { static_cast<std::size_t>(-1) };
+        float                                 _time             { 0.0f };   //播放时刻(秒) 保持在片段时长内
+        float                                 _lastTime         { -1.0f };  //上次蒙皮的时刻 置为负数强制重算
+        float                                 _transitionHalflife { 0.1f };
         float                                 _skeletonScale    { 0.02f };
+        Skinning::DiffusionMethod             _diffusion        { Skinning::DiffusionMethod::Sparse };
         int                                   _heatIterations { 20 };
         float                                 _heatLambda { 0.6f };
         float                                 _heatAnchorRadius { 0.05f };
@@ -51,13 +60,27 @@ namespace VCX::Labs::Final {
         Engine::SurfaceMesh                   _bindMesh;
         Engine::SurfaceMesh                   _sourceMesh;
         Engine::SurfaceMesh                   _customMesh;
-        Engine::SurfaceMesh                   _skinnedMesh;
+        std::vector<glm::vec3>                _skinnedPositions;  //CPU蒙皮的输出流 跨帧复用
+        std::vector<glm::vec3>                _skinnedNormals;
+        Skinning::SkinningScratch             _skinScratch;
+        std::vector<std::pair<std::size_t, std::size_t>> _segmentIndices;  //骨骼线段的关节序号 载入动作时计算一次
         std::vector<glm::vec3>                _skeletonSegments;
         std::vector<Skinning::Influence>      _weights;
         std::vector<glm::mat4>                _invBind;
+        Skinning::SkinningJob                 _bindJob;
+        Engine::SurfaceMesh                   _pendingMesh;     //已提交给后台绑定的网格 结果到达后替换_bindMesh
+        float                                 _pendingScale     { 0.02f };
+        float                                 _boundScale       { 0.02f };  //当前权重对应的骨骼尺度
+        Skinning::LinearBlendKernel           _kernel;
+        std::vector<glm::mat4>                _skinMats;
+        bool                                  _gpuSkinning      { false };
+        Skinning::SkinningMethod              _skinningMethod   { Skinning::SkinningMethod::Linear };
+        BenchmarkResult                       _benchmark;
 
         void                                  ResetModel();
-        void                                  UpdateAlignedMesh();
+        void                                  ClearWeights();
+        void                                  UpdateAlignedMesh(Engine::SurfaceMesh & mesh) const;
+        void                                  UploadModel();
 
         char const *                GetModelName(std::size_t const i) const { return Content::ModelNames[std::size_t(_models[i])].c_str(); }
         Engine::SurfaceMesh const & GetModelMesh(std::size_t const i) const { return Content::ModelMeshes[std::size_t(_models[i])]; }
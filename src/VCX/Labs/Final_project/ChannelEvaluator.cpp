@@ -0,0 +1,196 @@
+#include "Labs/Final_project/ChannelEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace VCX::Labs::Final {
+namespace {
+    constexpr std::size_t c_FrameBlock = 64;  //每次对所有关节组解码的帧数 使这一段帧数据留在缓存中
+
+    //轴序号: X = 0, Y = 1, Z = 2 不是该类通道时返回-1
+    int RotationAxis(BVHChannelType type) {
+        switch (type) {
+        case BVHChannelType::Xrotation: return 0;
+        case BVHChannelType::Yrotation: return 1;
+        case BVHChannelType::Zrotation: return 2;
+        default: return -1;
+        }
+    }
+
+    int PositionAxis(BVHChannelType type) {
+        switch (type) {
+        case BVHChannelType::Xposition: return 0;
+        case BVHChannelType::Yposition: return 1;
+        case BVHChannelType::Zposition: return 2;
+        default: return -1;
+        }
+    }
+
+    //四元数以(w, v)表示 右乘绕第K轴的旋转(cos, sin * e_K)
+    //等价于乘以glm::angleAxis 但省去了与0相乘的项 轴在编译期确定因此没有分支
+    template<int K>
+    inline void MultiplyAxis(float & w, float (&v)[3], float half) {
+        constexpr int K1 = (K + 1) % 3;
+        constexpr int K2 = (K + 2) % 3;
+        float c   = std::cos(half);
+        float s   = std::sin(half);
+        float nw  = w * c - v[K] * s;
+        float nk  = w * s + v[K] * c;
+        float nk1 = v[K1] * c + v[K2] * s;
+        float nk2 = v[K2] * c - v[K1] * s;
+        w     = nw;
+        v[K]  = nk;
+        v[K1] = nk1;
+        v[K2] = nk2;
+    }
+
+    inline void MultiplyAxis(int axis, float & w, float (&v)[3], float half) {
+        switch (axis) {
+        case 0: MultiplyAxis<0>(w, v, half); break;
+        case 1: MultiplyAxis<1>(w, v, half); break;
+        default: MultiplyAxis<2>(w, v, half); break;
+        }
+    }
+
+    //半角的计算顺序与glm::radians / glm::angleAxis一致
+    inline float HalfAngle(float degrees) {
+        return glm::radians(degrees) * 0.5f;
+    }
+} // namespace
+
+    //一组旋转通道序列相同的关节 按BVH通道顺序(内旋)逐轴右乘: q = q_A * q_B * q_C
+    template<int... Axes>
+    void BVHChannelEvaluator::DecodeGroup(
+        std::span<const RotationJoint> joints,
+        float const *                  frames,
+        std::size_t                    channelCount,
+        std::size_t                    jointCount,
+        std::size_t                    frameBegin,
+        std::size_t                    frameEnd,
+        glm::quat *                    rotations) {
+        constexpr int         axes[]  = { Axes... };
+        constexpr std::size_t count   = sizeof...(Axes);
+        for (std::size_t f = frameBegin; f < frameEnd; f++) {
+            float const * values = frames + f * channelCount;
+            glm::quat *   out    = rotations + f * jointCount;
+            for (auto const & joint : joints) {
+                float half = HalfAngle(values[joint.channels[0]]);
+                float w    = std::cos(half);
+                float v[3] {};
+                v[axes[0]] = std::sin(half);
+                if constexpr (count > 1) MultiplyAxis<axes[count > 1 ? 1 : 0]>(w, v, HalfAngle(values[joint.channels[1]]));
+                if constexpr (count > 2) MultiplyAxis<axes[count > 2 ? 2 : 0]>(w, v, HalfAngle(values[joint.channels[2]]));
+                out[joint.joint] = glm::quat(w, v[0], v[1], v[2]);
+            }
+        }
+    }
+
+    BVHChannelEvaluator::DecodeFn BVHChannelEvaluator::SelectDecoder(std::span<const int> axes) {
+        static constexpr auto c_One = []<int... I>(std::integer_sequence<int, I...>) {
+            return std::array<DecodeFn, sizeof...(I)> { &DecodeGroup<I>... };
+        }(std::make_integer_sequence<int, 3> {});
+        static constexpr auto c_Two = []<int... I>(std::integer_sequence<int, I...>) {
+            return std::array<DecodeFn, sizeof...(I)> { &DecodeGroup<I / 3, I % 3>... };
+        }(std::make_integer_sequence<int, 9> {});
+        static constexpr auto c_Three = []<int... I>(std::integer_sequence<int, I...>) {
+            return std::array<DecodeFn, sizeof...(I)> { &DecodeGroup<I / 9, I / 3 % 3, I % 3>... };
+        }(std::make_integer_sequence<int, 27> {});
+
+        int code = 0;
+        for (int axis : axes) code = code * 3 + axis;
+        switch (axes.size()) {
+        case 1: return c_One[code];
+        case 2: return c_Two[code];
+        case 3: return c_Three[code];
+        default: return nullptr;
+        }
+    }
+
+    void BVHChannelEvaluator::Compile(std::span<const BVHChannel> channels, std::size_t jointCount) {
+        _jointCount = jointCount;
+        _channelCount = channels.size();
+        _groups.clear();
+        _generic.clear();
+        _identityJoints.clear();
+        _translations.clear();
+        _translatedJoints.clear();
+
+        //按通道顺序收集每个关节的旋转轴 位移槽按关节第一次出现位移通道的顺序分配
+        std::vector<std::vector<std::pair<std::uint32_t, int>>> rotation_channels(jointCount);
+        std::vector<int> translated_slot(jointCount, -1);
+        for (std::size_t c = 0; c < channels.size(); c++) {
+            int idx = channels[c].joint_index;
+            if (idx < 0 || static_cast<std::size_t>(idx) >= jointCount) continue;
+            if (int axis = RotationAxis(channels[c].type); axis >= 0) {
+                rotation_channels[idx].emplace_back(static_cast<std::uint32_t>(c), axis);
+                continue;
+            }
+            int axis = PositionAxis(channels[c].type);
+            if (translated_slot[idx] < 0) {
+                translated_slot[idx] = static_cast<int>(_translatedJoints.size());
+                _translatedJoints.push_back(idx);
+            }
+            _translations.push_back({ static_cast<std::uint32_t>(c), static_cast<std::uint32_t>(translated_slot[idx]), static_cast<std::uint32_t>(axis) });
+        }
+
+        for (std::size_t j = 0; j < jointCount; j++) {
+            auto const & rot = rotation_channels[j];
+            if (rot.empty()) {
+                _identityJoints.push_back(static_cast<std::uint32_t>(j));
+                continue;
+            }
+            if (rot.size() > 3) {
+                GenericJoint generic { static_cast<std::uint32_t>(j), {}, {} };
+                for (auto [channel, axis] : rot) {
+                    generic.channels.push_back(channel);
+                    generic.axes.push_back(static_cast<std::uint8_t>(axis));
+                }
+                _generic.push_back(std::move(generic));
+                continue;
+            }
+            int           axes[3] {};
+            RotationJoint joint { static_cast<std::uint32_t>(j), {} };
+            for (std::size_t i = 0; i < rot.size(); i++) {
+                joint.channels[i] = rot[i].first;
+                axes[i] = rot[i].second;
+            }
+            DecodeFn decode = SelectDecoder(std::span<const int>(axes, rot.size()));
+            auto group = std::find_if(_groups.begin(), _groups.end(), [&](RotationGroup const & g) { return g.decode == decode; });
+            if (group == _groups.end()) group = _groups.insert(_groups.end(), RotationGroup { decode, {} });
+            group->joints.push_back(joint);
+        }
+    }
+
+    void BVHChannelEvaluator::Decode(
+        std::span<const float> frames,
+        std::size_t            frameBegin,
+        std::size_t            frameEnd,
+        std::span<glm::quat>   rotations,
+        std::span<glm::vec3>   translations) const {
+        const std::size_t slot_count = _translatedJoints.size();
+        for (std::size_t block = frameBegin; block < frameEnd; block += c_FrameBlock) {
+            const std::size_t block_end = std::min(frameEnd, block + c_FrameBlock);
+            for (auto const & group : _groups)
+                group.decode(group.joints, frames.data(), _channelCount, _jointCount, block, block_end, rotations.data());
+
+            for (std::size_t f = block; f < block_end; f++) {
+                float const * values = frames.data() + f * _channelCount;
+                glm::quat *   rot    = rotations.data() + f * _jointCount;
+                for (auto const & joint : _generic) {
+                    float w = 1.0f;
+                    float v[3] {};
+                    for (std::size_t i = 0; i < joint.channels.size(); i++)
+                        MultiplyAxis(joint.axes[i], w, v, HalfAngle(values[joint.channels[i]]));
+                    rot[joint.joint] = glm::quat(w, v[0], v[1], v[2]);
+                }
+                for (auto j : _identityJoints) rot[j] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+                //同一分量出现多次时以最后一个通道为准
+                glm::vec3 * pos = translations.data() + f * slot_count;
+                std::fill_n(pos, slot_count, glm::vec3(0.0f));
+                for (auto const & copy : _translations) pos[copy.slot][copy.component] = values[copy.channel];
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ReadBVH.h"
+
+namespace VCX::Labs::Final {
+    //按骨架编译一次的BVH通道求值器: 解码时不再逐通道判断类型
+    //每个关节的旋转通道序列(如ZXY)映射到按轴模板特化的欧拉角->四元数函数 相同序列的关节归为一组连续求值
+    //位移通道编译为(通道, 位移槽, 分量)的拷贝表 只为带位移通道的关节分配位移槽
+    class BVHChannelEvaluator {
+    public:
+        //jointCount之外的通道被忽略 通道布局为空时也成功(所有关节为单位旋转)
+        void Compile(std::span<const BVHChannel> channels, std::size_t jointCount);
+
+        std::size_t             JointCount() const { return _jointCount; }
+        std::size_t             ChannelCount() const { return _channelCount; }
+        std::span<const int>    TranslatedJoints() const { return _translatedJoints; }
+
+        //解码[frameBegin, frameEnd)帧 frames为整段剪辑的通道值(帧数 x ChannelCount())
+        //rotations/translations按帧数 x 关节数 / 帧数 x 位移槽数覆盖写入 各帧相互独立 可分段并行调用
+        void Decode(
+            std::span<const float> frames,
+            std::size_t            frameBegin,
+            std::size_t            frameEnd,
+            std::span<glm::quat>   rotations,
+            std::span<glm::vec3>   translations) const;
+
+    private:
+        struct RotationJoint {
+            std::uint32_t                joint;
+            std::array<std::uint32_t, 3> channels;  //按通道顺序 只用前axes个
+        };
+
+        //解码[frameBegin, frameEnd)帧中一组关节的旋转 frames指向第0帧
+        using DecodeFn = void (*)(std::span<const RotationJoint> joints, float const * frames, std::size_t channelCount, std::size_t jointCount, std::size_t frameBegin, std::size_t frameEnd, glm::quat * rotations);
+
+        struct RotationGroup {
+            DecodeFn                   decode;
+            std::vector<RotationJoint> joints;
+        };
+
+        //旋转通道超过3个的关节 逐通道按运行时的轴累乘
+        struct GenericJoint {
+            std::uint32_t              joint;
+            std::vector<std::uint32_t> channels;
+            std::vector<std::uint8_t>  axes;
+        };
+
+        template<int... Axes>
+        static void     DecodeGroup(std::span<const RotationJoint> joints, float const * frames, std::size_t channelCount, std::size_t jointCount, std::size_t frameBegin, std::size_t frameEnd, glm::quat * rotations);
+        static DecodeFn SelectDecoder(std::span<const int> axes);
+
+        struct TranslationCopy {
+            std::uint32_t channel;
+            std::uint32_t slot;
+            std::uint32_t component;
+        };
+
+        std::size_t                  _jointCount { 0 };
+        std::size_t                  _channelCount { 0 };
+        std::vector<RotationGroup>   _groups;
+        std::vector<GenericJoint>    _generic;
+        std::vector<std::uint32_t>   _identityJoints;  //没有旋转通道的关节
+        std::vector<TranslationCopy> _translations;
+        std::vector<int>             _translatedJoints;
+    };
+}
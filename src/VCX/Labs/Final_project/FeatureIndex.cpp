@@ -0,0 +1,108 @@
+#include "Labs/Final_project/FeatureIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace VCX::Labs::Final {
+namespace {
+    void ComputeBounds(std::span<const float> features, std::size_t dim, std::size_t begin, std::size_t end, std::vector<float> & bounds) {
+        std::size_t at = bounds.size();
+        bounds.resize(at + 2 * dim);
+        float * lo = bounds.data() + at;
+        float * hi = lo + dim;
+        std::fill(lo, lo + dim, std::numeric_limits<float>::max());
+        std::fill(hi, hi + dim, std::numeric_limits<float>::lowest());
+        for (std::size_t i = begin; i < end; i++) {
+            float const * f = features.data() + i * dim;
+            for (std::size_t d = 0; d < dim; d++) {
+                lo[d] = std::min(lo[d], f[d]);
+                hi[d] = std::max(hi[d], f[d]);
+            }
+        }
+    }
+} // namespace
+
+    void FeatureIndex::Clear() {
+        _features = {};
+        _dim = 0;
+        _ranges.clear();
+        _boxes.clear();
+        _smallBoxes.clear();
+        _boxBounds.clear();
+        _smallBounds.clear();
+    }
+
+    void FeatureIndex::Build(std::span<const float> features, std::size_t dim, std::span<const std::pair<std::size_t, std::size_t>> ranges) {
+        Clear();
+        _features = features;
+        _dim = dim;
+        _ranges.assign(ranges.begin(), ranges.end());
+        if (dim == 0) return;
+        //包围盒不跨越区间 保证盒内的帧都可被检索
+        for (auto const & range : _ranges) {
+            for (std::size_t large = range.first; large < range.second; large += c_LargeBox) {
+                std::size_t large_end = std::min(range.second, large + c_LargeBox);
+                Box box { large, large_end, _smallBoxes.size(), 0 };
+                for (std::size_t small = large; small < large_end; small += c_SmallBox) {
+                    std::size_t small_end = std::min(large_end, small + c_SmallBox);
+                    _smallBoxes.push_back(Box { small, small_end, 0, 0 });
+                    ComputeBounds(features, dim, small, small_end, _smallBounds);
+                }
+                box.child_end = _smallBoxes.size();
+                _boxes.push_back(box);
+                ComputeBounds(features, dim, large, large_end, _boxBounds);
+            }
+        }
+    }
+
+    //查询点到包围盒的平方距离 是盒内任一帧代价的下界; 超过best_cost即可停止累加
+    float FeatureIndex::BoxDistance(std::span<const float> bounds, std::size_t box, float const * query, float best_cost) const {
+        float const * lo = bounds.data() + box * 2 * _dim;
+        float const * hi = lo + _dim;
+        float cost = 0.0f;
+        for (std::size_t d = 0; d < _dim; d++) {
+            float q = query[d];
+            float gap = q < lo[d] ? lo[d] - q : (q > hi[d] ? q - hi[d] : 0.0f);
+            cost += gap * gap;
+            if (cost >= best_cost) break;
+        }
+        return cost;
+    }
+
+    void FeatureIndex::ScanFrames(std::size_t begin, std::size_t end, float const * query, std::pair<std::size_t, std::size_t> exclude, float & best_cost, std::ptrdiff_t & best) const {
+        for (std::size_t i = begin; i < end; i++) {
+            if (i >= exclude.first && i < exclude.second) continue;
+            float const * f = _features.data() + i * _dim;
+            float cost = 0.0f;
+            for (std::size_t d = 0; d < _dim; d++) {
+                float diff = query[d] - f[d];
+                cost += diff * diff;
+                if (cost >= best_cost) break;
+            }
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = static_cast<std::ptrdiff_t>(i);
+            }
+        }
+    }
+
+    //被排除的帧仍计入包围盒 盒距离依然是其余帧代价的下界
+    std::ptrdiff_t FeatureIndex::Search(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude) const {
+        std::ptrdiff_t best = -1;
+        float const * q = query.data();
+        for (std::size_t b = 0; b < _boxes.size(); b++) {
+            if (BoxDistance(_boxBounds, b, q, best_cost) >= best_cost) continue;
+            for (std::size_t s = _boxes[b].child_begin; s < _boxes[b].child_end; s++) {
+                if (BoxDistance(_smallBounds, s, q, best_cost) >= best_cost) continue;
+                ScanFrames(_smallBoxes[s].begin, _smallBoxes[s].end, q, exclude, best_cost, best);
+            }
+        }
+        return best;
+    }
+
+    std::ptrdiff_t FeatureIndex::SearchBruteForce(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude) const {
+        std::ptrdiff_t best = -1;
+        for (auto const & range : _ranges) ScanFrames(range.first, range.second, query.data(), exclude, best_cost, best);
+        return best;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace VCX::Labs::Final {
+    //特征向量的最近邻加速结构: 在每段连续帧区间上建立两级包围盒(大盒c_LargeBox帧 小盒c_SmallBox帧)
+    //检索时先用查询点到包围盒的距离下界剔除整段 再逐帧逐维累加并提前终止
+    //结果(包括相等代价时取较小序号)与按区间顺序穷举完全一致
+    class FeatureIndex {
+    public:
+        static constexpr std::size_t c_SmallBox = 16;
+        static constexpr std::size_t c_LargeBox = 64;
+
+        //features为行主序的count x dim矩阵 ranges为可检索的帧区间[begin, end) 特征数据需在索引使用期间保持有效
+        void Build(std::span<const float> features, std::size_t dim, std::span<const std::pair<std::size_t, std::size_t>> ranges);
+        void Clear();
+
+        std::size_t Dim() const { return _dim; }
+        bool        Empty() const { return _boxes.empty(); }
+
+        //best_cost为初始上界 找到更优的帧时更新best_cost并返回其序号 否则返回-1; 序号在exclude区间[first, second)内的帧不参与检索
+        std::ptrdiff_t Search(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude = { 0, 0 }) const;
+        std::ptrdiff_t SearchBruteForce(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude = { 0, 0 }) const;
+
+    private:
+        struct Box {
+            std::size_t begin;
+            std::size_t end;
+            std::size_t child_begin;  //大盒对应的小盒区间 小盒不使用
+            std::size_t child_end;
+        };
+
+        float BoxDistance(std::span<const float> bounds, std::size_t box, float const * query, float best_cost) const;
+        void  ScanFrames(std::size_t begin, std::size_t end, float const * query, std::pair<std::size_t, std::size_t> exclude, float & best_cost, std::ptrdiff_t & best) const;
+
+        std::span<const float>                           _features;
+        std::size_t                                      _dim { 0 };
+        std::vector<std::pair<std::size_t, std::size_t>> _ranges;
+        std::vector<Box>                                 _boxes;       //大盒
+        std::vector<Box>                                 _smallBoxes;
+        std::vector<float>                               _boxBounds;   //每个大盒min[dim] max[dim]
+        std::vector<float>                               _smallBounds;
+    };
+}
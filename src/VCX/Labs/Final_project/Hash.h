@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace VCX::Labs::Final {
+    //FNV-1a 64位哈希 可分多次追加数据 用于缓存文件的校验与索引
+    class Fnv1a64 {
+    public:
+        void Update(void const * data, std::size_t size) {
+            auto bytes = static_cast<unsigned char const *>(data);
+            for (std::size_t i = 0; i < size; i++) {
+                _state ^= bytes[i];
+                _state *= 1099511628211ull;
+            }
+        }
+
+        template<typename T>
+        void Update(std::span<T const> values) { Update(values.data(), values.size_bytes()); }
+
+        template<typename T>
+        void UpdateValue(T const & value) { Update(&value, sizeof(T)); }
+
+        std::uint64_t Digest() const { return _state; }
+
+    private:
+        std::uint64_t _state { 14695981039346656037ull };
+    };
+}
@@ -0,0 +1,220 @@
+#include "Labs/Final_project/HeatDiffusion.h"
+#include "Labs/Final_project/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+namespace VCX::Labs::Final::Skinning {
+namespace {
+    constexpr std::size_t c_ColumnBlock = 8;  //每次回代的右端项列数
+
+    //任一线程观察到取消后置位 其余线程不必再调用查询函数
+    bool Cancelled(CancelCheck const & cancelled, std::atomic_bool & stop) {
+        if (stop.load(std::memory_order_relaxed)) return true;
+        if (! cancelled || ! cancelled()) return false;
+        stop.store(true, std::memory_order_relaxed);
+        return true;
+    }
+} // namespace
+
+    struct HeatDiffusionSolver::Factorization {
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt;
+    };
+
+    HeatDiffusionSolver::HeatDiffusionSolver() = default;
+    HeatDiffusionSolver::~HeatDiffusionSolver() = default;
+    HeatDiffusionSolver::HeatDiffusionSolver(HeatDiffusionSolver &&) noexcept = default;
+    HeatDiffusionSolver & HeatDiffusionSolver::operator=(HeatDiffusionSolver &&) noexcept = default;
+
+    bool HeatDiffusionSolver::Ready() const {
+        return _factorization != nullptr;
+    }
+
+    void HeatDiffusionSolver::Clear() {
+        _factorization.reset();
+        _tau = 0.0f;
+        _free.clear();
+        _freeVertices.clear();
+        _degree.clear();
+        _pinnedOffsets.clear();
+        _pinnedNeighbors.clear();
+    }
+
+    bool HeatDiffusionSolver::Factorize(std::vector<std::vector<int>> const & neighbors, std::vector<unsigned char> const & pinned, float tau) {
+        Clear();
+        const std::size_t vcount = neighbors.size();
+        if (tau <= 0.0f || (! pinned.empty() && pinned.size() != vcount)) return false;
+        _tau = tau;
+        _free.assign(vcount, -1);
+        for (std::size_t v = 0; v < vcount; v++) {
+            if (neighbors[v].empty() || (! pinned.empty() && pinned[v])) continue;
+            _free[v] = static_cast<int>(_freeVertices.size());
+            _freeVertices.push_back(static_cast<int>(v));
+        }
+
+        const std::size_t n = _freeVertices.size();
+        std::vector<Eigen::Triplet<double>> triplets;
+        _degree.resize(n);
+        _pinnedOffsets.assign(1, 0);
+        for (std::size_t i = 0; i < n; i++) {
+            auto const & nb = neighbors[static_cast<std::size_t>(_freeVertices[i])];
+            double degree = static_cast<double>(nb.size());
+            _degree[i] = static_cast<float>(degree);
+            triplets.emplace_back(static_cast<int>(i), static_cast<int>(i), degree * (1.0 + tau));
+            for (int u : nb) {
+                int col = _free[static_cast<std::size_t>(u)];
+                if (col >= 0) triplets.emplace_back(static_cast<int>(i), col, -static_cast<double>(tau));
+                else _pinnedNeighbors.push_back(u);
+            }
+            _pinnedOffsets.push_back(static_cast<std::uint32_t>(_pinnedNeighbors.size()));
+        }
+
+        auto factorization = std::make_unique<Factorization>();
+        if (n > 0) {
+            Eigen::SparseMatrix<double> system(static_cast<Eigen::Index>(n), static_cast<Eigen::Index>(n));
+            system.setFromTriplets(triplets.begin(), triplets.end());
+            factorization->ldlt.compute(system);
+            if (factorization->ldlt.info() != Eigen::Success) {
+                Clear();
+                return false;
+            }
+        }
+        _factorization = std::move(factorization);
+        return true;
+    }
+
+    bool HeatDiffusionSolver::Solve(
+        std::span<const WeightColumn> initial,
+        std::vector<WeightColumn> &   result,
+        float                         minWeight,
+        unsigned                      workers,
+        CancelCheck const &           cancelled) const {
+        result.assign(initial.size(), {});
+        if (! Ready()) return false;
+        std::atomic_bool stop { false };
+        const std::size_t vcount = _free.size();
+        const std::size_t n = _freeVertices.size();
+        const double tau = _tau;
+        const std::size_t blocks = (initial.size() + c_ColumnBlock - 1) / c_ColumnBlock;
+        ParallelFor(blocks, 1, workers, [&](std::size_t blockBegin, std::size_t blockEnd) {
+            std::vector<float> w0(vcount, 0.0f);  //单列初值的稠密暂存 用完后按非零项清零
+            Eigen::MatrixXd rhs;
+            for (std::size_t block = blockBegin; block < blockEnd; block++) {
+                if (Cancelled(cancelled, stop)) return;
+                const std::size_t first = block * c_ColumnBlock;
+                const std::size_t cols = std::min(c_ColumnBlock, initial.size() - first);
+                rhs.setZero(static_cast<Eigen::Index>(n), static_cast<Eigen::Index>(cols));
+                for (std::size_t c = 0; c < cols; c++) {
+                    auto const & column = initial[first + c];
+                    for (std::size_t k = 0; k < column.vertices.size(); k++)
+                        w0[column.vertices[k]] = column.values[k];
+                    for (std::size_t i = 0; i < n; i++) {
+                        double b = _degree[i] * static_cast<double>(w0[static_cast<std::size_t>(_freeVertices[i])]);
+                        for (std::uint32_t k = _pinnedOffsets[i]; k < _pinnedOffsets[i + 1]; k++)
+                            b += tau * static_cast<double>(w0[static_cast<std::size_t>(_pinnedNeighbors[k])]);
+                        rhs(static_cast<Eigen::Index>(i), static_cast<Eigen::Index>(c)) = b;
+                    }
+                    for (std::uint32_t v : column.vertices) w0[v] = 0.0f;
+                }
+                Eigen::MatrixXd solution = n > 0 ? Eigen::MatrixXd(_factorization->ldlt.solve(rhs)) : Eigen::MatrixXd();
+                for (std::size_t c = 0; c < cols; c++) {
+                    auto const & column = initial[first + c];
+                    for (std::size_t k = 0; k < column.vertices.size(); k++)
+                        w0[column.vertices[k]] = column.values[k];
+                    auto & out = result[first + c];
+                    for (std::size_t v = 0; v < vcount; v++) {
+                        int i = _free[v];
+                        float w = i < 0 ? w0[v] : static_cast<float>(solution(i, static_cast<Eigen::Index>(c)));
+                        if (w >= minWeight && w > 0.0f) {
+                            out.vertices.push_back(static_cast<std::uint32_t>(v));
+                            out.values.push_back(w);
+                        }
+                    }
+                    for (std::uint32_t v : column.vertices) w0[v] = 0.0f;
+                }
+            }
+        });
+        return ! stop.load();
+    }
+
+    bool DiffuseJacobi(
+        std::vector<std::vector<int>> const &       neighbors,
+        std::span<const std::vector<std::uint32_t>> anchors,
+        float                                       lambda,
+        int                                         iterations,
+        std::span<const WeightColumn>               initial,
+        std::vector<WeightColumn> &                 result,
+        float                                       minWeight,
+        unsigned                                    workers,
+        CancelCheck const &                         cancelled) {
+        result.assign(initial.size(), {});
+        std::atomic_bool stop { false };
+        const std::size_t vcount = neighbors.size();
+        constexpr unsigned char c_Active = 1;
+        constexpr unsigned char c_Anchor = 2;
+        ParallelFor(initial.size(), 1, workers, [&](std::size_t begin, std::size_t end) {
+            //稠密暂存只按线程分配 每个关节结束后只清理触及的顶点
+            std::vector<float>         cur(vcount, 0.0f);
+            std::vector<float>         tmp(vcount, 0.0f);
+            std::vector<unsigned char> flags(vcount, 0);
+            std::vector<std::uint32_t> active;
+            for (std::size_t j = begin; j < end; j++) {
+                if (Cancelled(cancelled, stop)) return;
+                auto const & column = initial[j];
+                active.clear();
+                for (std::size_t k = 0; k < column.vertices.size(); k++) {
+                    std::uint32_t v = column.vertices[k];
+                    cur[v] = column.values[k];
+                    flags[v] |= c_Active;
+                    active.push_back(v);
+                }
+                if (j < anchors.size())
+                    for (std::uint32_t v : anchors[j]) flags[v] |= c_Anchor;
+
+                for (int it = 0; it < iterations && ! active.empty(); it++) {
+                    //支撑集向外扩张一圈 圈外的顶点本次迭代后仍精确为0
+                    std::size_t frontier = active.size();
+                    for (std::size_t a = 0; a < frontier; a++) {
+                        for (int u : neighbors[active[a]]) {
+                            if (flags[static_cast<std::size_t>(u)] & c_Active) continue;
+                            flags[static_cast<std::size_t>(u)] |= c_Active;
+                            active.push_back(static_cast<std::uint32_t>(u));
+                        }
+                    }
+                    for (std::uint32_t v : active) {
+                        auto const & nb = neighbors[v];
+                        if ((flags[v] & c_Anchor) || nb.empty()) {
+                            tmp[v] = cur[v];  //锚定点与孤立点权重不变
+                            continue;
+                        }
+                        float sum = 0.0f;
+                        for (int idx : nb)
+                            sum += cur[static_cast<std::size_t>(idx)];
+                        float avg = sum / static_cast<float>(nb.size());
+                        tmp[v] = (1.0f - lambda) * cur[v] + lambda * avg;
+                    }
+                    cur.swap(tmp);
+                }
+
+                std::sort(active.begin(), active.end());
+                auto & out = result[j];
+                for (std::uint32_t v : active) {
+                    float w = cur[v];
+                    if (w >= minWeight && w > 0.0f) {
+                        out.vertices.push_back(v);
+                        out.values.push_back(w);
+                    }
+                    cur[v] = 0.0f;
+                    tmp[v] = 0.0f;
+                    flags[v] = 0;
+                }
+                if (j < anchors.size())
+                    for (std::uint32_t v : anchors[j]) flags[v] = 0;
+            }
+        });
+        return ! stop.load();
+    }
+}
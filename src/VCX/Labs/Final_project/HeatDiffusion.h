@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace VCX::Labs::Final::Skinning {
+    //单个关节的稀疏权重 只存非零项 顶点序号严格升序
+    struct WeightColumn {
+        std::vector<std::uint32_t> vertices;
+        std::vector<float>         values;
+    };
+
+    //扩散过程中的取消查询 返回true时尽快中止 可能被多个工作线程同时调用
+    using CancelCheck = std::function<bool()>;
+
+    //逐关节显式Jacobi扩散: 每次迭代 w = (1 - lambda) * w + lambda * 邻居均值 anchors[j]中的顶点与孤立顶点保持初值
+    //只在非零支撑及其逐次向外扩张一圈的范围内计算 结果与在全部顶点上迭代逐位相同
+    //result只保留不小于minWeight的正值 各关节互不依赖 workers为0时使用硬件并发数
+    //每个关节开始前查询cancelled 被取消时返回false result中只有部分关节完成
+    bool DiffuseJacobi(
+        std::vector<std::vector<int>> const &           neighbors,
+        std::span<const std::vector<std::uint32_t>>     anchors,
+        float                                           lambda,
+        int                                             iterations,
+        std::span<const WeightColumn>                   initial,
+        std::vector<WeightColumn> &                     result,
+        float                                           minWeight = 0.0f,
+        unsigned                                        workers   = 1,
+        CancelCheck const &                             cancelled = {});
+
+    //隐式热扩散求解器: 对非固定顶点求解 (D + tau * (D - A)) w = D * w0 (固定邻居移到右端)
+    //D为度数对角阵 A为邻接矩阵 等价于把Jacobi平均迭代换成一次隐式时间步 tau相当于lambda * 迭代次数
+    //系数矩阵与关节无关: 拓扑/固定点/tau不变时只分解一次 之后每组右端项只需回代
+    class HeatDiffusionSolver {
+    public:
+        HeatDiffusionSolver();
+        ~HeatDiffusionSolver();
+        HeatDiffusionSolver(HeatDiffusionSolver &&) noexcept;
+        HeatDiffusionSolver & operator=(HeatDiffusionSolver &&) noexcept;
+
+        //neighbors需对称且去重 pinned[v]非0的顶点保持初值 孤立顶点同样保持初值
+        bool Factorize(std::vector<std::vector<int>> const & neighbors, std::vector<unsigned char> const & pinned, float tau);
+        void Clear();
+
+        bool        Ready() const;
+        std::size_t VertexCount() const { return _free.size(); }
+        std::size_t FreeCount() const { return _freeVertices.size(); }
+
+        //initial[j]为第j个关节的初值 result[j]只保留不小于minWeight的正值
+        //按列分块回代 稠密的右端矩阵只存在于单个列块内 各列块互不依赖 workers为0时使用硬件并发数
+        //每个列块开始前查询cancelled 未分解或被取消时返回false
+        bool Solve(
+            std::span<const WeightColumn> initial,
+            std::vector<WeightColumn> &   result,
+            float                         minWeight = 0.0f,
+            unsigned                      workers   = 1,
+            CancelCheck const &           cancelled = {}) const;
+
+    private:
+        struct Factorization;
+
+        std::unique_ptr<Factorization> _factorization;
+        float                          _tau { 0.0f };
+        std::vector<int>               _free;            //顶点 -> 未知量序号 固定点为-1
+        std::vector<int>               _freeVertices;    //未知量序号 -> 顶点
+        std::vector<float>             _degree;          //未知量的度数
+        std::vector<std::uint32_t>     _pinnedOffsets;   //未知量相邻的固定顶点 CSR
+        std::vector<int>               _pinnedNeighbors;
+    };
+}
@@ -1,4 +1,5 @@
-﻿#include <functional>
+﻿#include <algorithm>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include "HumanDS.h"
@@ -148,12 +149,106 @@ namespace VCX::Labs::Final{
         return copy;
     }
 
+    Skeleton HumanDS::ToSkeleton() const {
+        Skeleton skel;
+        if (! root) return skel;
+        std::function<void(const JointPtr &, int)> walk = [&](const JointPtr & j, int parent) {
+            if (! j) return;
+            int index = static_cast<int>(skel.parents.size());
+            skel.names.push_back(j->name);
+            skel.parents.push_back(parent);
+            skel.offsets.push_back(j->offset);
+            skel.local_rot.push_back(j->rotation);
+            skel.global_trans.push_back(j->global_trans);
+            skel.global_rot.push_back(j->global_rot);
+            for (auto const & child : j->children) walk(child, index);
+        };
+        walk(root, -1);
+        return skel;
+    }
+
+    int Skeleton::FindJoint(const std::string & name) const {
+        for (std::size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void Skeleton::UpdateGlobal() {
+        const std::size_t n = JointCount();
+        global_trans.resize(n);
+        global_rot.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            int p = parents[i];
+            if (p < 0) {
+                global_rot[i] = local_rot[i];
+                global_trans[i] = offsets[i];
+                continue;
+            }
+            global_rot[i] = global_rot[p] * local_rot[i];
+            global_trans[i] = global_trans[p] + glm::rotate(global_rot[p], offsets[i]);
+        }
+    }
+
+    std::vector<glm::vec3> Skeleton::GetSegments() const {
+        std::vector<glm::vec3> segments;
+        auto indices = GetSegmentIndices();
+        segments.reserve(indices.size() * 2);
+        for (auto const & seg : indices) {
+            segments.push_back(global_trans[seg.first]);
+            segments.push_back(global_trans[seg.second]);
+        }
+        return segments;
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> Skeleton::GetSegmentIndices() const {
+        std::vector<std::pair<std::size_t, std::size_t>> segments;
+        segments.reserve(JointCount());
+        for (std::size_t i = 0; i < JointCount(); i++) {
+            if (parents[i] >= 0)
+                segments.emplace_back(static_cast<std::size_t>(parents[i]), i);
+        }
+        //与HumanDS::GetSegmentIndices保持相同顺序: 先按父节点 再按子节点
+        std::stable_sort(segments.begin(), segments.end(),
+                         [](auto const & a, auto const & b) { return a.first < b.first; });
+        return segments;
+    }
+
+    void Motion::SetTracks(std::vector<glm::vec3> && translation_track, std::vector<glm::quat> && rotation_track) {
+        struct Tracks {
+            std::vector<glm::vec3> translations;
+            std::vector<glm::quat> rotations;
+        };
+        auto owned = std::make_shared<Tracks>(Tracks { std::move(translation_track), std::move(rotation_track) });
+        translations = owned->translations;
+        rotations = owned->rotations;
+        storage = std::move(owned);
+    }
+
+    bool Motion::GetPose(std::size_t frame_idx, Skeleton & pose) const {
+        if (frame_idx >= FrameCount()) return false;
+        const std::size_t joint_count = JointCount();
+        if (pose.parents != skeleton.parents) pose = skeleton;
+        std::copy_n(skeleton.offsets.begin(), joint_count, pose.offsets.begin());
+        std::copy_n(rotations.begin() + frame_idx * joint_count, joint_count, pose.local_rot.begin());
+        const std::size_t translated_count = translated_joints.size();
+        for (std::size_t t = 0; t < translated_count; t++) {
+            glm::vec3 delta = translations[frame_idx * translated_count + t];
+            if (delta != glm::vec3(0.0f)) pose.offsets[translated_joints[t]] += delta;
+        }
+        pose.UpdateGlobal();
+        return true;
+    }
+
     std::vector<glm::vec3> Motion::GetJointPositions(std::size_t frame_idx) const {
-        if (frame_idx >= frames.size()) return {};
-        std::vector<glm::vec3> out;
-        auto joints = frames[frame_idx].DFSJoints();
-        out.reserve(joints.size());
-        for (auto const & j : joints) out.push_back(j->get_globaltrans());
-        return out;
+        Skeleton pose;
+        if (! GetPose(frame_idx, pose)) return {};
+        return pose.global_trans;
+    }
+
+    std::vector<glm::vec3> Motion::GetSegments(std::size_t frame_idx) const {
+        Skeleton pose;
+        if (! GetPose(frame_idx, pose)) return {};
+        return pose.GetSegments();
     }
 }
@@ -3,6 +3,7 @@
 #define HUMANDS_H
 #include <cstddef>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
@@ -38,6 +39,7 @@ namespace VCX::Labs::Final{
         glm::vec3 get_globaltrans() const;
         glm::quat get_globalrot() const;
     };
+    class Skeleton;
     class HumanDS{
         JointPtr root;
         void UpdateGlobalRecursive(const JointPtr & joint);   //递归更新
@@ -54,14 +56,44 @@ namespace VCX::Labs::Final{
         std::vector<std::pair<std::size_t, std::size_t>> GetSegmentIndices() const;   //得到骨骼两端序号在DFS下的集合
         void UpdateGlobal();
         HumanDS Clone() const;
+        Skeleton ToSkeleton() const;   //转换为扁平的骨架表示
     };
 
+    //扁平的骨架表示: 关节按DFS顺序连续存放(父节点总在子节点之前) 用父节点序号代替指针
+    //关节序号与HumanDS::DFSJoints()一致
+    class Skeleton{
+    public:
+        std::vector<std::string> names;
+        std::vector<int>         parents;        //根节点为-1 且parents[i] < i
+        std::vector<glm::vec3>   offsets;
+        std::vector<glm::quat>   local_rot;
+        std::vector<glm::vec3>   global_trans;
+        std::vector<glm::quat>   global_rot;
+
+        std::size_t JointCount() const { return parents.size(); }
+        int FindJoint(const std::string & name) const;   //找不到时返回-1
+        void UpdateGlobal();   //按数组顺序线性地做前向运动学
+        std::vector<glm::vec3> GetSegments() const;
+        std::vector<std::pair<std::size_t, std::size_t>> GetSegmentIndices() const;
+    };
+
+    //动作片段: 骨架只保存一份 逐帧数据以稠密轨道(帧数 x 关节数)存放 全局姿态按需计算
     class Motion{
     public:
-        std::vector<HumanDS> frames;
+        Skeleton skeleton;                      //拓扑与静止姿态(局部旋转为单位四元数)
+        std::vector<int> translated_joints;     //带位移通道的关节序号
+        std::span<const glm::vec3> translations;   //FrameCount() x translated_joints.size() 叠加在offset上的位移
+        std::span<const glm::quat> rotations;      //FrameCount() x JointCount() 局部旋转
+        std::shared_ptr<const void> storage;       //轨道数据的持有者: 堆上数组或映射的缓存文件 拷贝Motion时共享
         float frame_time = 0.0f;
-        std::size_t FrameCount() const { return frames.size(); }
+
+        void SetTracks(std::vector<glm::vec3> && translation_track, std::vector<glm::quat> && rotation_track);
+
+        std::size_t JointCount() const { return skeleton.JointCount(); }
+        std::size_t FrameCount() const { return JointCount() == 0 ? 0 : rotations.size() / JointCount(); }
         std::vector<glm::vec3> GetJointPositions(std::size_t frame_idx) const;
+        std::vector<glm::vec3> GetSegments(std::size_t frame_idx) const;
+        bool GetPose(std::size_t frame_idx, Skeleton & pose) const;   //将第frame_idx帧写入扁平骨架 pose可跨帧复用
     };
 }
 
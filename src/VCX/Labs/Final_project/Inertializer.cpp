@@ -0,0 +1,124 @@
+#include "Labs/Final_project/Inertializer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Labs/Final_project/Spring.h"
+
+namespace VCX::Labs::Final {
+    namespace {
+        //旋转差值的模低于该值(弧度)且速度也很小时视为衰减完毕
+        constexpr float c_SettleEpsilon = 1e-5f;
+
+        glm::vec3 ToRotationVector(glm::quat q) {
+            if (q.w < 0.0f) q = -q;
+            glm::vec3 v(q.x, q.y, q.z);
+            float s = glm::length(v);
+            if (s < 1e-8f) return 2.0f * v;
+            return v * (2.0f * std::atan2(s, q.w) / s);
+        }
+
+        glm::quat FromRotationVector(glm::vec3 const & v) {
+            float angle = glm::length(v);
+            if (angle < 1e-8f) return glm::normalize(glm::quat(1.0f, 0.5f * v.x, 0.5f * v.y, 0.5f * v.z));
+            glm::vec3 axis = v * (std::sin(0.5f * angle) / angle);
+            return glm::quat(std::cos(0.5f * angle), axis.x, axis.y, axis.z);
+        }
+    } // namespace
+
+    void Inertializer::Reset() {
+        _pending = false;
+        _active = false;
+        _lastRot.clear();
+        _lastOffset.clear();
+        _sampleRot.clear();
+        _sampleOffset.clear();
+    }
+
+    void Inertializer::Transition(PoseView next, float dt) {
+        _nextRot.assign(next.rotations.begin(), next.rotations.end());
+        _nextOffset.assign(next.offsets.begin(), next.offsets.end());
+        _nextDt = dt;
+        _pending = true;
+    }
+
+    void Inertializer::Transition(Motion const & motion, float time) {
+        float next = std::min(time + PoseSampler::FrameTime(motion), PoseSampler::Duration(motion));
+        if (! _sampler.Sample(motion, next, _nextPose, PoseSampler::Wrap::Clamp)) {
+            Reset();
+            return;
+        }
+        Transition(LocalPose(_nextPose), PoseSampler::FrameTime(motion));
+    }
+
+    void Inertializer::Begin(Skeleton const & destination) {
+        const std::size_t joint_count = destination.JointCount();
+        _rotDiff.resize(joint_count);
+        _rotDiffVelocity.resize(joint_count);
+        _offsetDiff.resize(joint_count);
+        _offsetDiffVelocity.resize(joint_count);
+        const float inv_dt = 1.0f / _nextDt;
+        for (std::size_t j = 0; j < joint_count; j++) {
+            glm::quat const & dst = destination.local_rot[j];
+            glm::vec3 dst_rot_velocity = ToRotationVector(_nextRot[j] * glm::inverse(dst)) * inv_dt;
+            glm::vec3 dst_offset_velocity = (_nextOffset[j] - destination.offsets[j]) * inv_dt;
+            _rotDiff[j] = ToRotationVector(_lastRot[j] * glm::inverse(dst));
+            _rotDiffVelocity[j] = _rotVelocity[j] - dst_rot_velocity;
+            _offsetDiff[j] = _lastOffset[j] - destination.offsets[j];
+            _offsetDiffVelocity[j] = _offsetVelocity[j] - dst_offset_velocity;
+        }
+        _active = true;
+    }
+
+    void Inertializer::Update(Skeleton & pose, float halflife, float dt, float sampleDt) {
+        const std::size_t joint_count = pose.JointCount();
+        const bool has_history = _lastRot.size() == joint_count;
+        if (_pending) {
+            _pending = false;
+            if (has_history && _nextRot.size() == joint_count && _nextOffset.size() == joint_count && _nextDt > 0.0f)
+                Begin(pose);
+            else
+                _active = false;
+        }
+        if (! has_history) {
+            _active = false;
+            _lastRot = pose.local_rot;
+            _lastOffset = pose.offsets;
+            _sampleRot = pose.local_rot;
+            _sampleOffset = pose.offsets;
+            _rotVelocity.assign(joint_count, glm::vec3(0.0f));
+            _offsetVelocity.assign(joint_count, glm::vec3(0.0f));
+            return;
+        }
+
+        if (_active) {
+            bool settled = true;
+            for (std::size_t j = 0; j < joint_count; j++) {
+                if (dt > 0.0f) {
+                    Spring::DecaySpringDamperExact(_rotDiff[j], _rotDiffVelocity[j], halflife, dt);
+                    Spring::DecaySpringDamperExact(_offsetDiff[j], _offsetDiffVelocity[j], halflife, dt);
+                }
+                pose.local_rot[j] = FromRotationVector(_rotDiff[j]) * pose.local_rot[j];
+                pose.offsets[j] += _offsetDiff[j];
+                settled = settled
+                    && glm::length(_rotDiff[j]) < c_SettleEpsilon && glm::length(_rotDiffVelocity[j]) < c_SettleEpsilon
+                    && glm::length(_offsetDiff[j]) < c_SettleEpsilon && glm::length(_offsetDiffVelocity[j]) < c_SettleEpsilon;
+            }
+            if (settled) _active = false;
+            pose.UpdateGlobal();
+        }
+
+        //记录输出及其速度 作为下一次切换的源 速度与输入姿态使用同一时间基准
+        if (sampleDt > 0.0f) {
+            const float inv_dt = 1.0f / sampleDt;
+            for (std::size_t j = 0; j < joint_count; j++) {
+                _rotVelocity[j] = ToRotationVector(pose.local_rot[j] * glm::inverse(_sampleRot[j])) * inv_dt;
+                _offsetVelocity[j] = (pose.offsets[j] - _sampleOffset[j]) * inv_dt;
+            }
+            std::copy(pose.local_rot.begin(), pose.local_rot.end(), _sampleRot.begin());
+            std::copy(pose.offsets.begin(), pose.offsets.end(), _sampleOffset.begin());
+        }
+        std::copy(pose.local_rot.begin(), pose.local_rot.end(), _lastRot.begin());
+        std::copy(pose.offsets.begin(), pose.offsets.end(), _lastOffset.begin());
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "Labs/Final_project/HumanDS.h"
+#include "Labs/Final_project/PoseBlend.h"
+#include "Labs/Final_project/PoseSampler.h"
+
+namespace VCX::Labs::Final {
+    //惯性化过渡: 切换片段或跳帧时记录上一帧输出与目标姿态之差(局部旋转与offset)及两者速度之差
+    //之后每帧用临界阻尼弹簧把差值衰减到0并叠加在目标姿态上 只需对当前片段取样 不再求值源片段
+    //旋转差值以旋转向量(轴 * 角度)表示 左乘在局部旋转上; 速度为两次速度采样之间输出之差除以采样间隔
+    class Inertializer {
+    public:
+        //清除偏移与历史 下一次Update直接输出输入姿态
+        void Reset();
+
+        //切换时调用: next为目标动画在切换时刻之后dt秒的局部姿态 只用于估计目标速度
+        //下一次Update的输入即为切换时刻的目标姿态 关节数不一致或尚无输出历史时退化为直接切换
+        void Transition(PoseView next, float dt);
+        //便捷版本: 在motion上取样time之后一帧的姿态 只在切换时多取样一次
+        void Transition(Motion const & motion, float time);
+
+        //在pose的局部姿态上叠加衰减后的偏移并重算全局姿态 dt<=0时(暂停)偏移与速度保持不变
+        //输入姿态随时间连续取样时 速度采样间隔即为dt
+        void Update(Skeleton & pose, float halflife, float dt) { Update(pose, halflife, dt, dt); }
+        //输入姿态只在离散帧上变化时(如按片段帧率推进) 偏移仍按dt衰减 速度只在输入变化时采样:
+        //sampleDt为输入姿态自上次采样以来推进的动画时间 为0表示输入未变化 速度保持不变
+        void Update(Skeleton & pose, float halflife, float dt, float sampleDt);
+
+        bool Active() const { return _active; }
+
+    private:
+        void Begin(Skeleton const & destination);
+
+        bool                   _pending { false };
+        bool                   _active { false };    //偏移尚未衰减完
+        float                  _nextDt { 0.0f };
+        std::vector<glm::quat> _nextRot;
+        std::vector<glm::vec3> _nextOffset;
+
+        std::vector<glm::quat> _lastRot;             //上一帧输出 作为下一次切换的源
+        std::vector<glm::vec3> _lastOffset;
+        std::vector<glm::quat> _sampleRot;           //上次速度采样时的输出
+        std::vector<glm::vec3> _sampleOffset;
+        std::vector<glm::vec3> _rotVelocity;
+        std::vector<glm::vec3> _offsetVelocity;
+
+        std::vector<glm::vec3> _rotDiff;             //源 * inverse(目标)的旋转向量
+        std::vector<glm::vec3> _rotDiffVelocity;
+        std::vector<glm::vec3> _offsetDiff;
+        std::vector<glm::vec3> _offsetDiffVelocity;
+
+        PoseSampler            _sampler;
+        Skeleton               _nextPose;
+    };
+}
@@ -0,0 +1,59 @@
+#include "Labs/Final_project/MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VCX::Labs::Final {
+    std::shared_ptr<MappedFile const> MappedFile::Open(std::filesystem::path const & path) {
+        std::shared_ptr<MappedFile> mapped(new MappedFile());
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER size {};
+        if (! GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (! mapping) return nullptr;
+        void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); //视图会保持映射对象存活
+        if (! view) return nullptr;
+        mapped->_data = static_cast<std::byte const *>(view);
+        mapped->_size = static_cast<std::size_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return nullptr;
+        }
+        void * view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); //映射建立后即可关闭文件描述符
+        if (view == MAP_FAILED) return nullptr;
+        mapped->_data = static_cast<std::byte const *>(view);
+        mapped->_size = static_cast<std::size_t>(st.st_size);
+#endif
+        return mapped;
+    }
+
+    MappedFile::~MappedFile() {
+        if (! _data) return;
+#ifdef _WIN32
+        UnmapViewOfFile(_data);
+#else
+        munmap(const_cast<std::byte *>(_data), _size);
+#endif
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace VCX::Labs::Final {
+    //只读的内存映射文件 析构时解除映射
+    class MappedFile {
+    public:
+        //文件不存在、为空或映射失败时返回nullptr
+        static std::shared_ptr<MappedFile const> Open(std::filesystem::path const & path);
+
+        ~MappedFile();
+        MappedFile(MappedFile const &) = delete;
+        MappedFile & operator=(MappedFile const &) = delete;
+
+        std::span<std::byte const> Bytes() const { return { _data, _size }; }
+
+    private:
+        MappedFile() = default;
+
+        std::byte const * _data { nullptr };
+        std::size_t       _size { 0 };
+    };
+}
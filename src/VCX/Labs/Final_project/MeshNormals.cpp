@@ -0,0 +1,71 @@
+#include "Labs/Final_project/MeshNormals.h"
+
+#include <algorithm>
+
+#include "Labs/Final_project/Parallel.h"
+
+namespace VCX::Labs::Final {
+namespace {
+    constexpr std::size_t c_Grain = 4096;
+} // namespace
+
+    void ComputeNormals(std::span<const glm::vec3> positions, std::span<const std::uint32_t> indices, std::span<glm::vec3> normals) {
+        std::fill(normals.begin(), normals.end(), glm::vec3(0));
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::uint32_t const * face   = indices.data() + i;
+            glm::vec3 const &     p1     = positions[face[0]];
+            glm::vec3 const &     p2     = positions[face[1]];
+            glm::vec3 const &     p3     = positions[face[2]];
+            glm::vec3             normal = glm::cross(p2 - p1, p3 - p1);
+            normals[face[0]] += normal;
+            normals[face[1]] += normal;
+            normals[face[2]] += normal;
+        }
+        for (glm::vec3 & normal : normals)
+            normal = glm::normalize(normal);
+    }
+
+    void VertexFaceAdjacency::Clear() {
+        _offsets.clear();
+        _faces.clear();
+        _faceNormals.clear();
+    }
+
+    void VertexFaceAdjacency::Build(std::span<const std::uint32_t> indices, std::size_t vertexCount) {
+        Clear();
+        const std::size_t face_count = indices.size() / 3;
+        _offsets.assign(vertexCount + 1, 0);
+        for (std::size_t i = 0; i < face_count * 3; i++)
+            if (indices[i] < vertexCount) _offsets[indices[i] + 1]++;
+        for (std::size_t v = 0; v < vertexCount; v++) _offsets[v + 1] += _offsets[v];
+        //按面顺序填入 每个顶点的面列表天然有序
+        _faces.resize(_offsets.back());
+        std::vector<std::uint32_t> cursor(_offsets.begin(), _offsets.end() - 1);
+        for (std::size_t i = 0; i < face_count * 3; i++)
+            if (indices[i] < vertexCount) _faces[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+        _faceNormals.resize(face_count);
+    }
+
+    void VertexFaceAdjacency::ComputeNormals(
+        std::span<const glm::vec3>     positions,
+        std::span<const std::uint32_t> indices,
+        std::span<glm::vec3>           normals,
+        unsigned                       workers) const {
+        ParallelFor(_faceNormals.size(), c_Grain, workers, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t f = begin; f < end; f++) {
+                std::uint32_t const * face = indices.data() + f * 3;
+                glm::vec3 const &     p1   = positions[face[0]];
+                glm::vec3 const &     p2   = positions[face[1]];
+                glm::vec3 const &     p3   = positions[face[2]];
+                _faceNormals[f] = glm::cross(p2 - p1, p3 - p1);
+            }
+        });
+        ParallelFor(VertexCount(), c_Grain, workers, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t v = begin; v < end; v++) {
+                glm::vec3 normal(0);
+                for (std::uint32_t i = _offsets[v]; i < _offsets[v + 1]; i++) normal += _faceNormals[_faces[i]];
+                normals[v] = glm::normalize(normal);
+            }
+        });
+    }
+}
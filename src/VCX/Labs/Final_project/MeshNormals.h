@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VCX::Labs::Final {
+    //逐面散射累加后归一化 结果与SurfaceMesh::ComputeNormals一致 但写入调用方的缓冲 不分配内存
+    void ComputeNormals(std::span<const glm::vec3> positions, std::span<const std::uint32_t> indices, std::span<glm::vec3> normals);
+
+    //顶点到三角形的邻接表(CSR) 拓扑不变时只需构建一次
+    //法线重算分两趟: 并行计算面法线 再按顶点并行收集相邻面法线 没有写冲突
+    //每个顶点按面序号从小到大累加 结果与SurfaceMesh::ComputeNormals逐面散射完全一致
+    class VertexFaceAdjacency {
+    public:
+        void Build(std::span<const std::uint32_t> indices, std::size_t vertexCount);
+        void Clear();
+
+        std::size_t VertexCount() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+        std::size_t FaceCount() const { return _faceNormals.size(); }
+
+        //workers为0时使用硬件并发数
+        void ComputeNormals(
+            std::span<const glm::vec3>     positions,
+            std::span<const std::uint32_t> indices,
+            std::span<glm::vec3>           normals,
+            unsigned                       workers = 0) const;
+
+    private:
+        std::vector<std::uint32_t>     _offsets;  //顶点v的相邻面为_faces[_offsets[v], _offsets[v + 1])
+        std::vector<std::uint32_t>     _faces;
+        mutable std::vector<glm::vec3> _faceNormals;
+    };
+}
@@ -1,10 +1,11 @@
 ﻿#include "Labs/Final_project/ModelObject.h"
 
 namespace VCX::Labs::Final {
-    void ModelObject::ReplaceMesh(Engine::SurfaceMesh const & mesh) {
+    void ModelObject::ReplaceMesh(Engine::SurfaceMesh const & mesh, bool dynamic) {
+        auto frequency = dynamic ? Engine::GL::DrawFrequency::Stream : Engine::GL::DrawFrequency::Static;
         auto layout = Engine::GL::VertexLayout()
-            .Add<glm::vec3>("position", Engine::GL::DrawFrequency::Static, 0)
-            .Add<glm::vec3>("normal", Engine::GL::DrawFrequency::Static, 1);
+            .Add<glm::vec3>("position", frequency, 0)
+            .Add<glm::vec3>("normal", frequency, 1);
 
         if (mesh.IsTexCoordAvailable())
             layout = std::move(layout).Add<glm::vec2>("texcoord", Engine::GL::DrawFrequency::Static, 2);
@@ -19,6 +20,46 @@ namespace VCX::Labs::Final {
 
         _item.emplace(std::move(item));
         _texCoordAvailable = mesh.IsTexCoordAvailable();
+        _skinned = false;
+        _vertexCount = mesh.Positions.size();
+    }
+
+    bool ModelObject::UpdatePositionsNormals(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals) {
+        if (! _item.has_value() || _skinned || positions.size() != _vertexCount || normals.size() != _vertexCount)
+            return false;
+        _item->UpdateVertexBuffer("position", Engine::make_span_bytes<glm::vec3>(positions));
+        _item->UpdateVertexBuffer("normal", Engine::make_span_bytes<glm::vec3>(normals));
+        return true;
+    }
+
+    void ModelObject::ReplaceSkinnedMesh(Engine::SurfaceMesh const & bindMesh, std::span<const Skinning::PackedInfluence8> weights) {
+        if (weights.size() != bindMesh.Positions.size()) {
+            ReplaceMesh(bindMesh);
+            return;
+        }
+        //未使用的槽为关节0且权重为0 着色器中无需分支
+        auto layout = Engine::GL::VertexLayout()
+            .Add<glm::vec3>("position", Engine::GL::DrawFrequency::Static, 0)
+            .Add<glm::vec3>("normal", Engine::GL::DrawFrequency::Static, 1);
+        if (bindMesh.IsTexCoordAvailable())
+            layout = std::move(layout).Add<glm::vec2>("texcoord", Engine::GL::DrawFrequency::Static, 2);
+        layout = std::move(layout)
+            .Add<Skinning::PackedInfluence8>("influences", Engine::GL::DrawFrequency::Static)
+            .At(3, &Skinning::PackedInfluence8::joints)
+            .At(4, &Skinning::PackedInfluence8::weights, true);
+
+        Engine::GL::UniqueIndexedRenderItem item(layout, Engine::GL::PrimitiveType::Triangles);
+        item.UpdateVertexBuffer("position", Engine::make_span_bytes<glm::vec3>(bindMesh.Positions));
+        item.UpdateVertexBuffer("normal", Engine::make_span_bytes<glm::vec3>(bindMesh.IsNormalAvailable() ? bindMesh.Normals : bindMesh.ComputeNormals()));
+        if (bindMesh.IsTexCoordAvailable())
+            item.UpdateVertexBuffer("texcoord", Engine::make_span_bytes<glm::vec2>(bindMesh.TexCoords));
+        item.UpdateVertexBuffer("influences", Engine::make_span_bytes<Skinning::PackedInfluence8>(weights));
+        item.UpdateElementBuffer(bindMesh.Indices);
+
+        _item.emplace(std::move(item));
+        _texCoordAvailable = bindMesh.IsTexCoordAvailable();
+        _skinned = true;
+        _vertexCount = bindMesh.Positions.size();
     }
 
     void ModelObject::Draw(std::initializer_list<Engine::GL::scope_t> && scopes) {
@@ -1,11 +1,13 @@
 ﻿#pragma once
 
 #include <optional>
+#include <span>
 
 #include <glm/ext.hpp>
 
 #include "Engine/GL/RenderItem.h"
 #include "Engine/SurfaceMesh.h"
+#include "Labs/Final_project/PackedInfluence.h"
 
 namespace VCX::Labs::Final {
     class ModelObject {
@@ -13,10 +15,17 @@ namespace VCX::Labs::Final {
         ModelObject() { }
         ModelObject(Engine::SurfaceMesh const & mesh) { ReplaceMesh(mesh); }
 
-        void ReplaceMesh(Engine::SurfaceMesh const & mesh);
+        //dynamic为true时位置与法线使用Stream缓冲 适合之后逐帧调用UpdatePositionsNormals
+        void ReplaceMesh(Engine::SurfaceMesh const & mesh, bool dynamic = false);
+        //拓扑不变时只更新位置与法线 原地写入已有缓冲; 顶点数不符或当前为蒙皮网格时返回false
+        bool UpdatePositionsNormals(std::span<const glm::vec3> positions, std::span<const glm::vec3> normals);
+        //绑定姿态网格 + 每顶点的关节序号与权重 作为静态属性只上传一次 蒙皮在skinned.vert中完成
+        //关节序号与unorm8权重交错存放在同一个缓冲中 每顶点8字节
+        void ReplaceSkinnedMesh(Engine::SurfaceMesh const & bindMesh, std::span<const Skinning::PackedInfluence8> weights);
         void Draw(std::initializer_list<Engine::GL::scope_t> && scopes);
 
         bool        IsTexCoordAvailable() const { return _texCoordAvailable; }
+        bool        IsSkinned() const { return _skinned; }
         glm::mat4   GetTransform() const { return glm::translate(glm::mat4(1.f), _translate) * _rotate * glm::scale(glm::mat4(1.f), _scale); }
         void        Rotate(float const deg, glm::vec3 const & axis) { _rotate = glm::rotate(glm::mat4(1.f), glm::radians(deg), axis) * _rotate; }
         void        RotateX(float const deg) { _rotate = glm::rotate(glm::mat4(1.f), glm::radians(deg), glm::vec3(1.f, 0.f, 0.f)) * _rotate; }
@@ -29,6 +38,8 @@ namespace VCX::Labs::Final {
 
         std::optional<Engine::GL::UniqueIndexedRenderItem> _item;
         bool                                               _texCoordAvailable { false };
+        bool                                               _skinned           { false };
+        std::size_t                                        _vertexCount       { 0 };
         glm::mat4                                          _rotate            { 1.f };
         glm::vec3                                          _translate         { 0.f };
         glm::vec3                                          _scale             { 1.f };
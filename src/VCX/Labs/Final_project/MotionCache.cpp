@@ -0,0 +1,201 @@
+#include "Labs/Final_project/MotionCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include "Labs/Final_project/Hash.h"
+#include "Labs/Final_project/MappedFile.h"
+
+namespace VCX::Labs::Final {
+namespace {
+    constexpr char          c_Magic[4]         = { 'V', 'C', 'X', 'M' };
+    constexpr std::uint32_t c_Version          = 1;
+    constexpr std::uint64_t c_SectionAlignment = 64;
+
+    struct CacheHeader {
+        char          magic[4];
+        std::uint32_t version;
+        std::uint32_t quat_layout;       //glm::quat中w分量的下标 不同GLM配置的构建不能共用缓存
+        std::uint32_t joint_count;
+        std::uint32_t translated_count;
+        float         frame_time;
+        std::uint64_t frame_count;
+        std::uint64_t source_size;
+        std::int64_t  source_mtime;
+        std::uint64_t file_size;
+        std::uint64_t names_offset;
+        std::uint64_t names_bytes;
+        std::uint64_t parents_offset;
+        std::uint64_t offsets_offset;
+        std::uint64_t translated_offset;
+        std::uint64_t translations_offset;
+        std::uint64_t rotations_offset;
+        std::uint64_t checksum;          //计算时本字段置0
+    };
+
+    std::uint32_t QuatLayout() {
+        glm::quat q(1.0f, 0.0f, 0.0f, 0.0f);
+        float values[4];
+        std::memcpy(values, &q, sizeof(values));
+        return static_cast<std::uint32_t>(std::find(values, values + 4, 1.0f) - values);
+    }
+
+    std::uint64_t AlignUp(std::uint64_t v) {
+        return (v + c_SectionAlignment - 1) / c_SectionAlignment * c_SectionAlignment;
+    }
+
+    bool SourceStamp(const std::string & source, std::uint64_t & size, std::int64_t & mtime) {
+        std::error_code ec;
+        size = std::filesystem::file_size(source, ec);
+        if (ec) return false;
+        auto time = std::filesystem::last_write_time(source, ec);
+        if (ec) return false;
+        mtime = static_cast<std::int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    //按文件头中的数量计算各段偏移
+    void Layout(CacheHeader & h) {
+        std::uint64_t cursor = AlignUp(sizeof(CacheHeader));
+        auto place = [&](std::uint64_t & offset, std::uint64_t bytes) {
+            offset = cursor;
+            cursor = AlignUp(cursor + bytes);
+        };
+        place(h.names_offset, h.names_bytes);
+        place(h.parents_offset, sizeof(std::int32_t) * h.joint_count);
+        place(h.offsets_offset, sizeof(glm::vec3) * h.joint_count);
+        place(h.translated_offset, sizeof(std::int32_t) * h.translated_count);
+        place(h.translations_offset, sizeof(glm::vec3) * h.frame_count * h.translated_count);
+        place(h.rotations_offset, sizeof(glm::quat) * h.frame_count * h.joint_count);
+        h.file_size = cursor;
+    }
+
+    //头部(checksum置0)与骨架各段 帧数据不参与校验以保持零拷贝加载
+    std::uint64_t Checksum(CacheHeader h, std::byte const * base) {
+        h.checksum = 0;
+        Fnv1a64 hash;
+        hash.UpdateValue(h);
+        hash.Update(base + h.names_offset, h.names_bytes);
+        hash.Update(base + h.parents_offset, sizeof(std::int32_t) * h.joint_count);
+        hash.Update(base + h.offsets_offset, sizeof(glm::vec3) * h.joint_count);
+        hash.Update(base + h.translated_offset, sizeof(std::int32_t) * h.translated_count);
+        return hash.Digest();
+    }
+} // namespace
+
+    std::filesystem::path MotionCachePath(const std::string & source) {
+        return std::filesystem::path(source + ".vcxm");
+    }
+
+    bool LoadMotionCache(const std::string & source, Motion & out) {
+        std::uint64_t source_size = 0;
+        std::int64_t  source_mtime = 0;
+        if (! SourceStamp(source, source_size, source_mtime)) return false;
+
+        auto file = MappedFile::Open(MotionCachePath(source));
+        if (! file) return false;
+        auto bytes = file->Bytes();
+        if (bytes.size() < sizeof(CacheHeader)) return false;
+
+        CacheHeader h;
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (std::memcmp(h.magic, c_Magic, sizeof(c_Magic)) != 0 || h.version != c_Version || h.quat_layout != QuatLayout()) return false;
+        if (h.source_size != source_size || h.source_mtime != source_mtime) return false;
+        if (h.joint_count == 0) return false;
+
+        CacheHeader expected = h;
+        Layout(expected);
+        if (std::memcmp(&expected, &h, sizeof(h)) != 0 || h.file_size != bytes.size()) return false;
+        if (Checksum(h, bytes.data()) != h.checksum) return false;
+
+        Motion motion;
+        auto & skel = motion.skeleton;
+        const std::size_t joint_count = h.joint_count;
+        char const * name = reinterpret_cast<char const *>(bytes.data() + h.names_offset);
+        char const * names_end = name + h.names_bytes;
+        for (std::size_t i = 0; i < joint_count; i++) {
+            char const * terminator = std::find(name, names_end, '\0');
+            if (terminator == names_end) return false;
+            skel.names.emplace_back(name, terminator);
+            name = terminator + 1;
+        }
+        skel.parents.resize(joint_count);
+        skel.offsets.resize(joint_count);
+        std::memcpy(skel.parents.data(), bytes.data() + h.parents_offset, sizeof(std::int32_t) * joint_count);
+        std::memcpy(skel.offsets.data(), bytes.data() + h.offsets_offset, sizeof(glm::vec3) * joint_count);
+        for (std::size_t i = 0; i < joint_count; i++) {
+            if (skel.parents[i] >= static_cast<int>(i) || (i > 0 && skel.parents[i] < 0)) return false;
+        }
+        skel.local_rot.assign(joint_count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        skel.UpdateGlobal();
+
+        motion.translated_joints.resize(h.translated_count);
+        std::memcpy(motion.translated_joints.data(), bytes.data() + h.translated_offset, sizeof(std::int32_t) * h.translated_count);
+        for (int j : motion.translated_joints) {
+            if (j < 0 || static_cast<std::size_t>(j) >= joint_count) return false;
+        }
+
+        motion.frame_time = h.frame_time;
+        motion.translations = std::span<const glm::vec3>(
+            reinterpret_cast<glm::vec3 const *>(bytes.data() + h.translations_offset), h.frame_count * h.translated_count);
+        motion.rotations = std::span<const glm::quat>(
+            reinterpret_cast<glm::quat const *>(bytes.data() + h.rotations_offset), h.frame_count * joint_count);
+        motion.storage = std::move(file);
+        out = std::move(motion);
+        return true;
+    }
+
+    bool SaveMotionCache(const std::string & source, const Motion & motion) {
+        const auto & skel = motion.skeleton;
+        if (skel.JointCount() == 0) return false;
+
+        CacheHeader h {};
+        std::memcpy(h.magic, c_Magic, sizeof(c_Magic));
+        h.version = c_Version;
+        h.quat_layout = QuatLayout();
+        h.joint_count = static_cast<std::uint32_t>(skel.JointCount());
+        h.translated_count = static_cast<std::uint32_t>(motion.translated_joints.size());
+        h.frame_time = motion.frame_time;
+        h.frame_count = motion.FrameCount();
+        if (! SourceStamp(source, h.source_size, h.source_mtime)) return false;
+        for (auto const & n : skel.names) h.names_bytes += n.size() + 1;
+        Layout(h);
+
+        std::vector<std::byte> buffer(h.file_size, std::byte { 0 });
+        std::byte * base = buffer.data();
+        std::byte * name = base + h.names_offset;
+        for (auto const & n : skel.names) {
+            std::memcpy(name, n.data(), n.size());
+            name += n.size() + 1;
+        }
+        std::vector<std::int32_t> parents(skel.parents.begin(), skel.parents.end());
+        std::vector<std::int32_t> translated(motion.translated_joints.begin(), motion.translated_joints.end());
+        std::memcpy(base + h.parents_offset, parents.data(), sizeof(std::int32_t) * parents.size());
+        std::memcpy(base + h.offsets_offset, skel.offsets.data(), sizeof(glm::vec3) * skel.offsets.size());
+        std::memcpy(base + h.translated_offset, translated.data(), sizeof(std::int32_t) * translated.size());
+        std::memcpy(base + h.translations_offset, motion.translations.data(), motion.translations.size_bytes());
+        std::memcpy(base + h.rotations_offset, motion.rotations.data(), motion.rotations.size_bytes());
+        h.checksum = Checksum(h, base);
+        std::memcpy(base, &h, sizeof(h));
+
+        //先写临时文件再替换 避免其他进程映射到写了一半的缓存
+        auto path = MotionCachePath(source);
+        auto tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (! file) return false;
+            file.write(reinterpret_cast<char const *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            if (! file) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if (! ec) return true;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "HumanDS.h"
+
+namespace VCX::Labs::Final {
+    //二进制动作缓存(.vcxm) 依次为: 文件头、关节名、父节点序号、关节offset、位移通道关节、位移轨道、旋转轨道
+    //各段按64字节对齐 加载时直接映射文件 Motion的轨道指向映射内存而不做拷贝
+    //源文件的大小或修改时间与文件头记录不符、版本不符、或头部与骨架段的校验和不符时视为失效
+    std::filesystem::path MotionCachePath(const std::string & source);
+
+    bool LoadMotionCache(const std::string & source, Motion & out);
+    bool SaveMotionCache(const std::string & source, const Motion & motion);
+}
@@ -0,0 +1,338 @@
+#include "Labs/Final_project/MotionMatching.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "Labs/Final_project/Spring.h"
+
+namespace VCX::Labs::Final {
+namespace {
+    int FindAnyJoint(Skeleton const & skel, std::initializer_list<char const *> names) {
+        for (auto name : names) {
+            int idx = skel.FindJoint(name);
+            if (idx >= 0) return idx;
+        }
+        return 0;
+    }
+
+    //髋部前方投影到水平面 作为根节点朝向
+    glm::quat YawFromRotation(glm::quat const & rot) {
+        glm::vec3 fwd = rot * glm::vec3(0.0f, 0.0f, 1.0f);
+        if (fwd.x * fwd.x + fwd.z * fwd.z < 1e-8f) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        return glm::angleAxis(std::atan2(fwd.x, fwd.z), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    glm::vec3 Horizontal(glm::vec3 v) {
+        v.y = 0.0f;
+        return v;
+    }
+
+    //取出index帧的姿态 并改写为相对该帧根节点(髋部在地面的投影)的表示 不同片段的帧因此可以直接相减
+    bool RootRelativePose(MatchingDatabase const & db, std::span<const Motion> clips, std::size_t index, Skeleton & pose) {
+        auto entry = db.GetEntry(index);
+        if (! clips[entry.clip].GetPose(entry.frame, pose) || pose.JointCount() == 0) return false;
+        glm::quat inv_root = glm::inverse(db.RootRotation(index));
+        glm::vec3 origin = db.RootPosition(index);
+        //根节点的局部变换即其全局变换 整棵树随之刚体变换 无需重做前向运动学
+        pose.local_rot[0] = inv_root * pose.local_rot[0];
+        pose.offsets[0] = inv_root * (pose.offsets[0] - origin);
+        for (std::size_t i = 0; i < pose.JointCount(); i++) {
+            pose.global_trans[i] = inv_root * (pose.global_trans[i] - origin);
+            pose.global_rot[i] = inv_root * pose.global_rot[i];
+        }
+        return true;
+    }
+
+    //特征分组: [begin, end)与对应权重
+    struct FeatureGroup {
+        std::size_t begin;
+        std::size_t end;
+        float       weight;
+    };
+} // namespace
+
+    void MatchingDatabase::Clear() {
+        *this = MatchingDatabase {};
+    }
+
+    bool MatchingDatabase::Build(std::span<const Motion> clips, MatchingWeights const & weights) {
+        Clear();
+        constexpr std::size_t D = c_FeatureDim;
+
+        std::size_t total = 0;
+        _clipStart.push_back(0);
+        for (auto const & clip : clips) {
+            total += clip.FrameCount();
+            _clipStart.push_back(total);
+        }
+        _entries.resize(total);
+        _searchable.assign(total, 0);
+        _features.assign(total * D, 0.0f);
+        _rootPosition.resize(total);
+        _rootRotation.resize(total);
+        _rootDelta.assign(total, glm::vec3(0.0f));
+        _rootYawDelta.assign(total, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+        double speed_sum = 0.0;
+        std::size_t speed_count = 0;
+        Skeleton pose;
+        std::vector<glm::vec3> hips, lfoot, rfoot;
+        for (std::size_t c = 0; c < clips.size(); c++) {
+            Motion const & clip = clips[c];
+            const std::size_t frames = clip.FrameCount();
+            const std::size_t base = _clipStart[c];
+            const float dt = clip.frame_time > 0.0f ? clip.frame_time : 1.0f / 30.0f;
+            _frameTime.push_back(dt);
+            if (frames == 0) continue;
+
+            const int hip_idx = 0;
+            const int lfoot_idx = FindAnyJoint(clip.skeleton, { "LeftFoot", "LeftAnkle", "lFoot", "LFoot" });
+            const int rfoot_idx = FindAnyJoint(clip.skeleton, { "RightFoot", "RightAnkle", "rFoot", "RFoot" });
+
+            hips.resize(frames);
+            lfoot.resize(frames);
+            rfoot.resize(frames);
+            for (std::size_t f = 0; f < frames; f++) {
+                clip.GetPose(f, pose);
+                hips[f] = pose.global_trans[hip_idx];
+                lfoot[f] = pose.global_trans[lfoot_idx];
+                rfoot[f] = pose.global_trans[rfoot_idx];
+                _rootPosition[base + f] = Horizontal(hips[f]);
+                _rootRotation[base + f] = YawFromRotation(pose.global_rot[hip_idx]);
+                _entries[base + f] = Entry { static_cast<std::uint32_t>(c), static_cast<std::uint32_t>(f) };
+            }
+
+            std::array<std::size_t, c_TrajectorySamples> offsets;
+            for (std::size_t s = 0; s < c_TrajectorySamples; s++)
+                offsets[s] = std::max<std::size_t>(1, static_cast<std::size_t>(std::lround(c_TrajectoryTimes[s] / dt)));
+            //末尾不足以提取未来轨迹的帧不参与检索
+            if (frames > offsets.back() + 1) {
+                std::size_t end = base + frames - offsets.back() - 1;
+                _ranges.emplace_back(base, end);
+                std::fill(_searchable.begin() + base, _searchable.begin() + end, 1);
+            }
+
+            for (std::size_t f = 0; f < frames; f++) {
+                const std::size_t i = base + f;
+                glm::quat inv_root = glm::inverse(_rootRotation[i]);
+                glm::vec3 root = _rootPosition[i];
+                std::size_t prev = f > 0 ? f - 1 : 0;
+                std::size_t next = f > 0 ? f : std::min<std::size_t>(1, frames - 1);
+                auto velocity = [&](std::vector<glm::vec3> const & track) {
+                    return inv_root * ((track[next] - track[prev]) / dt);
+                };
+
+                float * out = _features.data() + i * D;
+                auto write3 = [&](std::size_t at, glm::vec3 const & v) {
+                    out[at + 0] = v.x;
+                    out[at + 1] = v.y;
+                    out[at + 2] = v.z;
+                };
+                write3(0, inv_root * (lfoot[f] - root));
+                write3(3, inv_root * (rfoot[f] - root));
+                write3(6, velocity(lfoot));
+                write3(9, velocity(rfoot));
+                write3(12, velocity(hips));
+                for (std::size_t s = 0; s < c_TrajectorySamples; s++) {
+                    std::size_t future = std::min(f + offsets[s], frames - 1);
+                    glm::vec3 p = inv_root * (_rootPosition[base + future] - root);
+                    glm::vec3 d = inv_root * (_rootRotation[base + future] * glm::vec3(0.0f, 0.0f, 1.0f));
+                    out[c_TrajectoryOffset + s * 2 + 0] = p.x;
+                    out[c_TrajectoryOffset + s * 2 + 1] = p.z;
+                    out[c_TrajectoryOffset + 2 * c_TrajectorySamples + s * 2 + 0] = d.x;
+                    out[c_TrajectoryOffset + 2 * c_TrajectorySamples + s * 2 + 1] = d.z;
+                }
+
+                if (f + 1 < frames) {
+                    _rootDelta[i] = inv_root * (_rootPosition[i + 1] - root);
+                    _rootYawDelta[i] = inv_root * _rootRotation[i + 1];
+                    speed_sum += glm::length(_rootDelta[i]) / dt;
+                    speed_count++;
+                }
+            }
+        }
+        _meanSpeed = speed_count > 0 ? static_cast<float>(speed_sum / speed_count) : 0.0f;
+        if (_ranges.empty()) return false;
+
+        //按组归一化: 每维减去均值 同组共用一个标准差(组内各维标准差的平均)
+        const FeatureGroup groups[] = {
+            { 0, 6, weights.footPosition },
+            { 6, 12, weights.footVelocity },
+            { 12, 15, weights.hipVelocity },
+            { c_TrajectoryOffset, c_TrajectoryOffset + 2 * c_TrajectorySamples, weights.trajectoryPosition },
+            { c_TrajectoryOffset + 2 * c_TrajectorySamples, D, weights.trajectoryDirection },
+        };
+        std::array<double, D> mean {};
+        std::array<double, D> var {};
+        for (std::size_t i = 0; i < total; i++)
+            for (std::size_t d = 0; d < D; d++) mean[d] += _features[i * D + d];
+        for (std::size_t d = 0; d < D; d++) mean[d] /= static_cast<double>(total);
+        for (std::size_t i = 0; i < total; i++)
+            for (std::size_t d = 0; d < D; d++) {
+                double diff = _features[i * D + d] - mean[d];
+                var[d] += diff * diff;
+            }
+        for (auto const & g : groups) {
+            double std_sum = 0.0;
+            for (std::size_t d = g.begin; d < g.end; d++) std_sum += std::sqrt(var[d] / static_cast<double>(total));
+            float std_dev = static_cast<float>(std_sum / static_cast<double>(g.end - g.begin));
+            float scale = (std_dev > 1e-6f ? std_dev : 1.0f) / std::max(g.weight, 1e-6f);
+            for (std::size_t d = g.begin; d < g.end; d++) {
+                _offset[d] = static_cast<float>(mean[d]);
+                _scale[d] = scale;
+            }
+        }
+        for (std::size_t i = 0; i < total; i++)
+            for (std::size_t d = 0; d < D; d++) _features[i * D + d] = (_features[i * D + d] - _offset[d]) / _scale[d];
+        _index.Build(_features, D, _ranges);
+        return true;
+    }
+
+    void MatchingDatabase::SetQueryTrajectory(
+        std::span<float>                                   query,
+        std::array<glm::vec2, c_TrajectorySamples> const & positions,
+        std::array<glm::vec2, c_TrajectorySamples> const & directions) const {
+        for (std::size_t s = 0; s < c_TrajectorySamples; s++) {
+            std::size_t p = c_TrajectoryOffset + s * 2;
+            std::size_t d = c_TrajectoryOffset + 2 * c_TrajectorySamples + s * 2;
+            query[p + 0] = (positions[s].x - _offset[p + 0]) / _scale[p + 0];
+            query[p + 1] = (positions[s].y - _offset[p + 1]) / _scale[p + 1];
+            query[d + 0] = (directions[s].x - _offset[d + 0]) / _scale[d + 0];
+            query[d + 1] = (directions[s].y - _offset[d + 1]) / _scale[d + 1];
+        }
+    }
+
+    float MatchingDatabase::Cost(std::span<const float> query, std::size_t index) const {
+        const float * f = _features.data() + index * c_FeatureDim;
+        float cost = 0.0f;
+        for (std::size_t d = 0; d < c_FeatureDim; d++) {
+            float diff = query[d] - f[d];
+            cost += diff * diff;
+        }
+        return cost;
+    }
+
+    void MotionMatchingController::Reset(MatchingDatabase const & db) {
+        _entry = db.Ranges().empty() ? 0 : db.Ranges().front().first;
+        _framesSinceSearch = searchInterval;
+        _timeAccum = 0.0f;
+        _searchCount = 0;
+        _jumped = false;
+        _inertializer.Reset();
+        _rootPosition = glm::vec3(0.0f);
+        _rootRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        _velocity = glm::vec3(0.0f);
+        _acceleration = glm::vec3(0.0f);
+        _trajectory.clear();
+    }
+
+    void MotionMatchingController::PredictTrajectory(glm::vec3 const & desired_velocity) {
+        glm::vec3 facing = _rootRotation * glm::vec3(0.0f, 0.0f, 1.0f);
+        float yaw = std::atan2(facing.x, facing.z);
+        float desired_yaw = glm::length(desired_velocity) > 1e-4f ? std::atan2(desired_velocity.x, desired_velocity.z) : yaw;
+        float delta_yaw = std::remainder(desired_yaw - yaw, 2.0f * 3.14159265358979f);
+
+        _trajectory.clear();
+        _trajectory.push_back(_rootPosition);
+        for (std::size_t s = 0; s < MatchingDatabase::c_TrajectorySamples; s++) {
+            float t = MatchingDatabase::c_TrajectoryTimes[s];
+            glm::vec3 x = _rootPosition;
+            glm::vec3 v = _velocity;
+            glm::vec3 a = _acceleration;
+            Spring::CharacterUpdate(x, v, a, desired_velocity, velocityHalflife, t);
+            float alpha = 1.0f - std::exp2(-t / std::max(rotationHalflife, 1e-4f));
+            float future_yaw = yaw + delta_yaw * alpha;
+            _futurePosition[s] = x;
+            _futureDirection[s] = glm::vec3(std::sin(future_yaw), 0.0f, std::cos(future_yaw));
+            _trajectory.push_back(x);
+        }
+    }
+
+    void MotionMatchingController::Search(MatchingDatabase const & db, bool force) {
+        constexpr std::size_t D = MatchingDatabase::c_FeatureDim;
+        _query.resize(D);
+        auto current = db.Features(_entry);
+        std::copy(current.begin(), current.end(), _query.begin());
+
+        glm::quat inv_root = glm::inverse(_rootRotation);
+        std::array<glm::vec2, MatchingDatabase::c_TrajectorySamples> positions;
+        std::array<glm::vec2, MatchingDatabase::c_TrajectorySamples> directions;
+        for (std::size_t s = 0; s < MatchingDatabase::c_TrajectorySamples; s++) {
+            glm::vec3 p = inv_root * (_futurePosition[s] - _rootPosition);
+            glm::vec3 d = inv_root * _futureDirection[s];
+            positions[s] = glm::vec2(p.x, p.z);
+            directions[s] = glm::vec2(d.x, d.z);
+        }
+        db.SetQueryTrajectory(_query, positions, directions);
+
+        //当前帧仍可检索时以其代价为上界 只有更优的帧才会跳转
+        //到达末尾时当前帧的姿态代价为0 若参与检索几乎总会选中自己 因此不设上界并排除末尾的searchInterval帧
+        //(跳回其中任一帧都播放不满一个检索间隔就会再次到达末尾)
+        float best_cost = ! force && db.IsSearchable(_entry) ? db.Cost(_query, _entry) : std::numeric_limits<float>::max();
+        std::pair<std::size_t, std::size_t> exclude { 0, 0 };
+        if (force) {
+            std::size_t clip_begin = db.IndexOf(db.GetEntry(_entry).clip, 0);
+            std::size_t window = static_cast<std::size_t>(std::max(searchInterval, 1));
+            exclude = { _entry - std::min(_entry - clip_begin, window - 1), _entry + 1 };
+        }
+        std::ptrdiff_t best = db.Search(_query, best_cost, exclude);
+        if (best >= 0) {
+            _entry = static_cast<std::size_t>(best);
+            _jumped = true;
+        }
+        _framesSinceSearch = 0;
+        _searchCount++;
+    }
+
+    void MotionMatchingController::Update(MatchingDatabase const & db, std::span<const Motion> clips, glm::vec3 const & desired_velocity, float dt) {
+        if (db.Ranges().empty()) return;
+
+        glm::vec3 goal = Horizontal(desired_velocity);
+        glm::vec3 position = _rootPosition;
+        Spring::CharacterUpdate(position, _velocity, _acceleration, goal, velocityHalflife, dt);
+        PredictTrajectory(goal);
+
+        //下一帧越过片段的可检索范围时需立即重新检索
+        auto at_end = [&]() { return _entry + 1 >= db.EntryCount() || ! db.IsSearchable(_entry + 1); };
+
+        //按片段帧率推进 每帧累积根运动
+        float advanced = 0.0f;
+        _timeAccum += dt;
+        while (_timeAccum >= db.FrameTime(_entry)) {
+            _timeAccum -= db.FrameTime(_entry);
+            advanced += db.FrameTime(_entry);
+            _rootPosition += _rootRotation * db.RootDelta(_entry);
+            _rootRotation = glm::normalize(_rootRotation * db.RootYawDelta(_entry));
+            bool end = at_end();
+            if (! end) _entry++;
+            _framesSinceSearch++;
+            if (end || _framesSinceSearch >= searchInterval) Search(db, end);
+        }
+        if (_framesSinceSearch >= searchInterval) Search(db, at_end());
+
+        EvaluatePose(db, clips, dt, advanced);
+    }
+
+    void MotionMatchingController::EvaluatePose(MatchingDatabase const & db, std::span<const Motion> clips, float dt, float advanced) {
+        if (! RootRelativePose(db, clips, _entry, _local)) return;
+        //跳转时以目标的下一帧估计目标速度 跳转前后的姿态差由惯性化逐渐衰减
+        if (_jumped) {
+            auto entry = db.GetEntry(_entry);
+            bool has_next = _entry + 1 < db.EntryCount() && db.GetEntry(_entry + 1).clip == entry.clip;
+            if (RootRelativePose(db, clips, has_next ? _entry + 1 : _entry, _next))
+                _inertializer.Transition(LocalPose(_next), db.FrameTime(_entry));
+            _jumped = false;
+        }
+        //姿态只在帧序号变化时改变 偏移按显示帧的dt衰减 速度按片段时间采样
+        _inertializer.Update(_local, transitionHalflife, dt, advanced);
+
+        //相对根节点的姿态对齐到角色的根节点
+        if (_pose.parents != _local.parents) _pose = _local;
+        for (std::size_t i = 0; i < _local.JointCount(); i++) {
+            _pose.global_trans[i] = _rootRotation * _local.global_trans[i] + _rootPosition;
+            _pose.global_rot[i] = _rootRotation * _local.global_rot[i];
+        }
+    }
+}
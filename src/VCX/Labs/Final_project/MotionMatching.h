@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "FeatureIndex.h"
+#include "HumanDS.h"
+#include "Inertializer.h"
+
+namespace VCX::Labs::Final {
+    //各组特征的权重 归一化时先除以该组的标准差再乘以权重
+    struct MatchingWeights {
+        float footPosition        = 0.75f;
+        float footVelocity        = 1.0f;
+        float hipVelocity         = 1.0f;
+        float trajectoryPosition  = 1.0f;
+        float trajectoryDirection = 1.5f;
+    };
+
+    //动作匹配特征库: 对每个片段的每一帧提取特征 均表示在该帧根节点(髋部在地面的投影 朝向为髋部前方)的局部坐标系中
+    //特征向量布局: 左/右脚位置(6) 左/右脚速度(6) 髋部速度(3) 未来轨迹位置xz(6) 未来轨迹朝向xz(6)
+    class MatchingDatabase {
+    public:
+        static constexpr std::size_t                       c_TrajectorySamples = 3;
+        static constexpr std::array<float, c_TrajectorySamples> c_TrajectoryTimes { 1.0f / 3.0f, 2.0f / 3.0f, 1.0f }; //未来采样时刻(秒)
+        static constexpr std::size_t                       c_TrajectoryOffset  = 15;
+        static constexpr std::size_t                       c_FeatureDim        = c_TrajectoryOffset + 4 * c_TrajectorySamples;
+
+        struct Entry {
+            std::uint32_t clip;
+            std::uint32_t frame;
+        };
+
+        //索引引用_features的存储 只允许移动
+        MatchingDatabase() = default;
+        MatchingDatabase(MatchingDatabase const &) = delete;
+        MatchingDatabase & operator=(MatchingDatabase const &) = delete;
+        MatchingDatabase(MatchingDatabase &&) = default;
+        MatchingDatabase & operator=(MatchingDatabase &&) = default;
+
+        //clips需在数据库使用期间保持有效 没有可搜索帧时返回false
+        bool Build(std::span<const Motion> clips, MatchingWeights const & weights = {});
+        void Clear();
+
+        std::size_t EntryCount() const { return _entries.size(); }
+        std::size_t ClipCount() const { return _clipStart.empty() ? 0 : _clipStart.size() - 1; }
+        Entry       GetEntry(std::size_t index) const { return _entries[index]; }
+        std::size_t IndexOf(std::size_t clip, std::size_t frame) const { return _clipStart[clip] + frame; }
+        float       FrameTime(std::size_t index) const { return _frameTime[_entries[index].clip]; }
+        float       MeanSpeed() const { return _meanSpeed; }
+
+        //index之后还能顺序播放且仍可被检索的帧
+        bool IsSearchable(std::size_t index) const { return _searchable[index] != 0; }
+        std::span<const std::pair<std::size_t, std::size_t>> Ranges() const { return _ranges; }
+
+        std::span<const float> Features(std::size_t index) const { return { _features.data() + index * c_FeatureDim, c_FeatureDim }; }
+        std::span<const float> AllFeatures() const { return _features; }
+
+        //该帧根节点的全局位置与朝向 以及到下一帧的根运动(在该帧根节点局部坐标系中)
+        glm::vec3 RootPosition(std::size_t index) const { return _rootPosition[index]; }
+        glm::quat RootRotation(std::size_t index) const { return _rootRotation[index]; }
+        glm::vec3 RootDelta(std::size_t index) const { return _rootDelta[index]; }
+        glm::quat RootYawDelta(std::size_t index) const { return _rootYawDelta[index]; }
+
+        //将局部坐标系中的期望轨迹写入query的轨迹段并归一化
+        void SetQueryTrajectory(
+            std::span<float>                                        query,
+            std::array<glm::vec2, c_TrajectorySamples> const &      positions,
+            std::array<glm::vec2, c_TrajectorySamples> const &      directions) const;
+
+        float Cost(std::span<const float> query, std::size_t index) const;
+
+        //在所有可搜索帧中检索 best_cost为初始上界 找到更优的帧时更新best_cost并返回其序号 否则返回-1
+        //Search经由包围盒索引剪枝 SearchBruteForce逐帧穷举 两者结果一致; exclude区间内的帧不参与检索
+        std::ptrdiff_t Search(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude = { 0, 0 }) const { return _index.Search(query, best_cost, exclude); }
+        std::ptrdiff_t SearchBruteForce(std::span<const float> query, float & best_cost, std::pair<std::size_t, std::size_t> exclude = { 0, 0 }) const { return _index.SearchBruteForce(query, best_cost, exclude); }
+
+    private:
+        std::vector<Entry>                               _entries;
+        std::vector<std::size_t>                         _clipStart;
+        std::vector<float>                               _frameTime;
+        std::vector<unsigned char>                       _searchable;
+        std::vector<std::pair<std::size_t, std::size_t>> _ranges;
+        std::vector<float>                               _features;
+        std::array<float, c_FeatureDim>                  _offset {};
+        std::array<float, c_FeatureDim>                  _scale {};
+        std::vector<glm::vec3>                           _rootPosition;
+        std::vector<glm::quat>                           _rootRotation;
+        std::vector<glm::vec3>                           _rootDelta;
+        std::vector<glm::quat>                           _rootYawDelta;
+        float                                            _meanSpeed { 0.0f };
+        FeatureIndex                                     _index;
+    };
+
+    //动作匹配角色控制器: 由期望速度预测未来轨迹 每隔若干动画帧检索一次最匹配的帧 其余时间顺序播放并累积根运动
+    //跳转到新的帧时用惯性化消除姿态的突变 每帧只求值当前帧
+    class MotionMatchingController {
+    public:
+        int   searchInterval    = 10;
+        float velocityHalflife  = 0.27f;
+        float rotationHalflife  = 0.27f;
+        float transitionHalflife = 0.1f;  //跳转后姿态差值的衰减半衰期
+
+        void Reset(MatchingDatabase const & db);
+        //desired_velocity为世界坐标系下的期望水平速度
+        void Update(MatchingDatabase const & db, std::span<const Motion> clips, glm::vec3 const & desired_velocity, float dt);
+
+        Skeleton const &                  Pose() const { return _pose; }  //世界坐标系下的姿态 只有global_trans/global_rot有效
+        glm::vec3                         RootPosition() const { return _rootPosition; }
+        std::span<const glm::vec3>        Trajectory() const { return _trajectory; }
+        std::size_t                       CurrentEntry() const { return _entry; }
+        std::size_t                       SearchCount() const { return _searchCount; }
+
+    private:
+        void PredictTrajectory(glm::vec3 const & desired_velocity);
+        //force为true时当前帧已到可检索范围的末尾 必须跳转到别处
+        void Search(MatchingDatabase const & db, bool force = false);
+        //advanced为本次Update推进的片段时间 用作惯性化的速度采样间隔
+        void EvaluatePose(MatchingDatabase const & db, std::span<const Motion> clips, float dt, float advanced);
+
+        std::size_t                       _entry { 0 };
+        int                               _framesSinceSearch { 0 };
+        float                             _timeAccum { 0.0f };
+        std::size_t                       _searchCount { 0 };
+        bool                              _jumped { false };
+        glm::vec3                         _rootPosition { 0.0f };
+        glm::quat                         _rootRotation { 1.0f, 0.0f, 0.0f, 0.0f };
+        glm::vec3                         _velocity { 0.0f };
+        glm::vec3                         _acceleration { 0.0f };
+        std::array<glm::vec3, MatchingDatabase::c_TrajectorySamples> _futurePosition {};
+        std::array<glm::vec3, MatchingDatabase::c_TrajectorySamples> _futureDirection {};
+        std::vector<glm::vec3>            _trajectory;
+        std::vector<float>                _query;
+        Skeleton                          _local;
+        Skeleton                          _next;      //跳转目标的下一帧 用于估计目标速度
+        Inertializer                      _inertializer;
+        Skeleton                          _pose;
+    };
+}
@@ -0,0 +1,79 @@
+#include "Labs/Final_project/PackedInfluence.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VCX::Labs::Final::Skinning {
+namespace {
+    template<typename Packed>
+    bool PackOne(Influence const & in, Packed & out) {
+        std::array<int, 4>   slot {};
+        std::array<float, 4> weight {};
+        int                  n     = 0;
+        double               total = 0.0;
+        for (int k = 0; k < 4; k++) {
+            if (in.joints[k] < 0 || ! (in.weights[k] > 0.0f)) continue;
+            if (static_cast<std::size_t>(in.joints[k]) >= Packed::c_JointLimit) return false;
+            slot[n]   = k;
+            weight[n] = in.weights[k];
+            total += in.weights[k];
+            n++;
+        }
+        out = {};
+        if (n == 0) return true;
+
+        //最大余数法: 先向下取整 剩余的单位分给小数部分最大的槽 并列时取原顺序靠前者
+        constexpr std::uint32_t c_Max = Packed::c_WeightMax;
+        std::array<std::uint32_t, 4> q {};
+        std::array<double, 4>        frac {};
+        std::uint32_t                assigned = 0;
+        for (int i = 0; i < n; i++) {
+            double scaled = weight[i] / total * c_Max;
+            q[i]    = static_cast<std::uint32_t>(std::floor(scaled));
+            frac[i] = scaled - q[i];
+            assigned += q[i];
+        }
+        std::array<int, 4> order { 0, 1, 2, 3 };
+        std::stable_sort(order.begin(), order.begin() + n, [&](int a, int b) { return frac[a] > frac[b]; });
+        for (std::uint32_t r = 0; assigned < c_Max; r++, assigned++) q[order[r % n]]++;
+
+        //按量化后的权重降序排列 权重为0的影响丢弃
+        std::array<int, 4> rank { 0, 1, 2, 3 };
+        std::stable_sort(rank.begin(), rank.begin() + n, [&](int a, int b) { return q[a] > q[b]; });
+        for (int i = 0; i < n; i++) {
+            int s = rank[i];
+            if (q[s] == 0) break;
+            out.joints[i]  = static_cast<typename Packed::Joint>(in.joints[slot[s]]);
+            out.weights[i] = static_cast<typename Packed::Weight>(q[s]);
+        }
+        return true;
+    }
+} // namespace
+
+    template<typename Packed>
+    bool PackInfluences(std::span<const Influence> weights, std::vector<Packed> & packed) {
+        packed.resize(weights.size());
+        for (std::size_t v = 0; v < weights.size(); v++) {
+            if (! PackOne(weights[v], packed[v])) {
+                packed.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename Packed>
+    Influence UnpackInfluence(Packed const & packed) {
+        Influence out { { -1, -1, -1, -1 }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+        for (std::uint32_t k = 0; k < packed.Count(); k++) {
+            out.joints[k]  = packed.joints[k];
+            out.weights[k] = packed.weights[k] / static_cast<float>(Packed::c_WeightMax);
+        }
+        return out;
+    }
+
+    template bool PackInfluences<PackedInfluence8>(std::span<const Influence>, std::vector<PackedInfluence8> &);
+    template bool PackInfluences<PackedInfluence16>(std::span<const Influence>, std::vector<PackedInfluence16> &);
+    template Influence UnpackInfluence<PackedInfluence8>(PackedInfluence8 const &);
+    template Influence UnpackInfluence<PackedInfluence16>(PackedInfluence16 const &);
+}
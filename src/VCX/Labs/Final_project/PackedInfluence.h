@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "Labs/Final_project/Skinning.h"
+
+namespace VCX::Labs::Final::Skinning {
+    //量化的每顶点影响 可直接作为顶点属性上传(joints不归一化 weights按unorm归一化)
+    //有效影响按权重降序排在前面 之后的槽关节与权重均为0 因此Count()之后的槽无需判断即可跳过
+    //各槽权重之和恰为c_WeightMax 即反量化后之和恰为1
+    template<typename JointT, typename WeightT>
+    struct PackedInfluence {
+        using Joint  = JointT;
+        using Weight = WeightT;
+
+        static constexpr std::size_t   c_JointLimit = std::size_t(std::numeric_limits<JointT>::max()) + 1;
+        static constexpr std::uint32_t c_WeightMax  = std::numeric_limits<WeightT>::max();
+
+        std::array<JointT, 4>  joints;
+        std::array<WeightT, 4> weights;
+
+        std::uint32_t Count() const {
+            std::uint32_t n = 0;
+            while (n < 4 && weights[n] != 0) n++;
+            return n;
+        }
+    };
+
+    using PackedInfluence8  = PackedInfluence<std::uint8_t, std::uint8_t>;    //8字节 GPU蒙皮使用 调色板最多256个关节
+    using PackedInfluence16 = PackedInfluence<std::uint16_t, std::uint16_t>;  //16字节 CPU内核使用
+
+    static_assert(sizeof(PackedInfluence8) == 8 && sizeof(PackedInfluence16) == 16);
+
+    //权重先归一化 再按最大余数法取整使和恰为c_WeightMax 取整为0的影响被丢弃
+    //关节序号超出Joint的表示范围时返回false 没有有效影响的顶点各槽均为0
+    template<typename Packed>
+    bool PackInfluences(std::span<const Influence> weights, std::vector<Packed> & packed);
+
+    template<typename Packed>
+    Influence UnpackInfluence(Packed const & packed);
+}
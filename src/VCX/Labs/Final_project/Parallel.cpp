@@ -0,0 +1,101 @@
+#include "Labs/Final_project/Parallel.h"
+
+namespace VCX::Labs::Final {
+namespace {
+    thread_local bool t_InPool = false;
+    thread_local ThreadPool * t_Current = nullptr;
+} // namespace
+
+    ThreadPool::ThreadPool(unsigned threads) {
+        _threads.reserve(threads);
+        for (unsigned i = 0; i < threads; i++) _threads.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto & t : _threads) t.join();
+    }
+
+    ThreadPool & ThreadPool::Shared() {
+        static ThreadPool pool(ResolveWorkerCount(0) - 1);
+        return pool;
+    }
+
+    ThreadPool & ThreadPool::Current() {
+        return t_Current ? *t_Current : Shared();
+    }
+
+    ThreadPool::Scope::Scope(ThreadPool & pool) :
+        _previous(t_Current) {
+        t_Current = &pool;
+    }
+
+    ThreadPool::Scope::~Scope() {
+        t_Current = _previous;
+    }
+
+    void ThreadPool::Run(std::size_t count, TaskRef task) {
+        if (count == 0) return;
+        std::unique_lock submit(_submit, std::try_to_lock);
+        if (t_InPool || _threads.empty() || count == 1 || ! submit.owns_lock()) {
+            for (std::size_t i = 0; i < count; i++) task(i);
+            return;
+        }
+
+        {
+            //上一组中迟到的工作线程全部离开后才能重置状态
+            std::unique_lock lock(_mutex);
+            _done.wait(lock, [this]() { return _active == 0; });
+            _task = &task;
+            _count = count;
+            _finished = 0;
+            _next.store(0, std::memory_order_relaxed);
+            _generation++;
+        }
+        _wake.notify_all();
+
+        t_InPool = true;
+        std::size_t finished = 0;
+        for (std::size_t i = _next.fetch_add(1); i < count; i = _next.fetch_add(1)) {
+            task(i);
+            finished++;
+        }
+        t_InPool = false;
+
+        std::unique_lock lock(_mutex);
+        _finished += finished;
+        _done.wait(lock, [this]() { return _finished == _count && _active == 0; });
+        _task = nullptr;
+    }
+
+    void ThreadPool::WorkerLoop() {
+        t_InPool = true;
+        std::uint64_t seen = 0;
+        std::unique_lock lock(_mutex);
+        while (true) {
+            _wake.wait(lock, [&]() { return _stop || _generation != seen; });
+            if (_stop) return;
+            seen = _generation;
+            auto const * task = _task;
+            const std::size_t count = _count;
+            if (! task) continue;
+            _active++;
+            lock.unlock();
+
+            std::size_t finished = 0;
+            for (std::size_t i = _next.fetch_add(1); i < count; i = _next.fetch_add(1)) {
+                (*task)(i);
+                finished++;
+            }
+
+            lock.lock();
+            _finished += finished;
+            _active--;
+            if (_active == 0) _done.notify_all();
+        }
+    }
+}
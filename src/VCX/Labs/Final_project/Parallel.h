@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace VCX::Labs::Final {
+    //workers为0时使用硬件并发数
+    inline unsigned ResolveWorkerCount(unsigned workers) {
+        if (workers > 0) return workers;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    //不持有可调用对象的轻量引用 被引用的对象需在调用期间保持有效
+    //与std::function不同 捕获较多时也不分配堆内存 每帧调用的并行循环因此没有分配
+    class TaskRef {
+    public:
+        template<typename Func>
+            requires (! std::is_same_v<std::remove_cvref_t<Func>, TaskRef>)
+        TaskRef(Func const & func) :
+            _object(&func),
+            _invoke([](void const * object, std::size_t i) { (*static_cast<Func const *>(object))(i); }) {
+        }
+
+        void operator()(std::size_t i) const { _invoke(_object, i); }
+
+    private:
+        void const * _object;
+        void (*_invoke)(void const *, std::size_t);
+    };
+
+    //常驻线程池: 避免每帧创建/销毁线程 同一时刻只执行一个任务组
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned threads);
+        ~ThreadPool();
+
+        ThreadPool(ThreadPool const &) = delete;
+        ThreadPool & operator=(ThreadPool const &) = delete;
+
+        //硬件并发数-1个工作线程 调用线程也参与计算
+        static ThreadPool & Shared();
+        //当前线程上ParallelFor使用的池: 处于Scope内时为其指定的池 否则为Shared()
+        static ThreadPool & Current();
+
+        //在作用域内把当前线程的ParallelFor改派到pool 用于长时间的后台任务
+        //后台任务与每帧任务若共用Shared() 后到的一方会因池被占用而退化为串行
+        class Scope {
+        public:
+            explicit Scope(ThreadPool & pool);
+            ~Scope();
+
+            Scope(Scope const &) = delete;
+            Scope & operator=(Scope const &) = delete;
+
+        private:
+            ThreadPool * _previous;
+        };
+
+        unsigned Size() const { return static_cast<unsigned>(_threads.size()) + 1; }
+
+        //执行task(0) ... task(count - 1) 返回时全部完成
+        //在池线程内嵌套调用 或池正被其他线程占用时 直接在调用线程上串行执行
+        void Run(std::size_t count, TaskRef task);
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread>                 _threads;
+        std::mutex                               _submit;
+        std::mutex                               _mutex;
+        std::condition_variable                  _wake;
+        std::condition_variable                  _done;
+        TaskRef const *                          _task { nullptr };
+        std::size_t                              _count { 0 };
+        std::atomic<std::size_t>                 _next { 0 };
+        std::size_t                              _finished { 0 };
+        unsigned                                 _active { 0 };
+        std::uint64_t                            _generation { 0 };
+        bool                                     _stop { false };
+    };
+
+    //将[0, count)切成至多workers个连续区间 每个区间不小于grain 并行调用func(begin, end)
+    //调用线程也参与计算 返回时所有区间都已完成
+    template<typename Func>
+    void ParallelFor(std::size_t count, std::size_t grain, unsigned workers, Func && func) {
+        if (count == 0) return;
+        grain = std::max<std::size_t>(1, grain);
+        std::size_t chunks = std::min<std::size_t>(ResolveWorkerCount(workers), (count + grain - 1) / grain);
+        if (chunks <= 1) {
+            func(std::size_t(0), count);
+            return;
+        }
+        std::size_t step = (count + chunks - 1) / chunks;
+        auto task = [&func, step, count](std::size_t c) {
+            std::size_t begin = c * step;
+            std::size_t end = std::min(count, begin + step);
+            if (begin < end) func(begin, end);
+        };
+        ThreadPool::Current().Run(chunks, task);
+    }
+}
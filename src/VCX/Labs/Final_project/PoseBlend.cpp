@@ -0,0 +1,239 @@
+#include "Labs/Final_project/PoseBlend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VCX_POSEBLEND_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace VCX::Labs::Final {
+    namespace {
+        //混合结果的模平方低于该值时视为退化 退回poses[0]的旋转
+        constexpr float c_MinNorm2 = 1e-12f;
+
+        static_assert(sizeof(glm::quat) == 4 * sizeof(float), "quaternions are blended as packed float4");
+
+        float Dot4(float const * a, float const * b) {
+            return ((a[0] * b[0] + a[1] * b[1]) + a[2] * b[2]) + a[3] * b[3];
+        }
+
+        //逐关节的nlerp 运算顺序与SIMD版本一致 两者结果逐位相同
+        void BlendRotationsScalar(
+            std::span<const PoseView> poses,
+            float const *             weights,
+            std::size_t               begin,
+            std::size_t               end,
+            float *                   out) {
+            for (std::size_t j = begin; j < end; j++) {
+                float const * q0 = reinterpret_cast<float const *>(poses[0].rotations.data() + j);
+                float acc[4];
+                for (int c = 0; c < 4; c++) acc[c] = q0[c] * weights[0];
+                for (std::size_t i = 1; i < poses.size(); i++) {
+                    float const * qi = reinterpret_cast<float const *>(poses[i].rotations.data() + j);
+                    float w = Dot4(q0, qi) < 0.0f ? -weights[i] : weights[i];
+                    for (int c = 0; c < 4; c++) acc[c] = acc[c] + qi[c] * w;
+                }
+                float n2 = Dot4(acc, acc);
+                float * o = out + j * 4;
+                if (n2 > c_MinNorm2) {
+                    float n = std::sqrt(n2);
+                    for (int c = 0; c < 4; c++) o[c] = acc[c] / n;
+                } else {
+                    for (int c = 0; c < 4; c++) o[c] = q0[c];
+                }
+            }
+        }
+
+#ifdef VCX_POSEBLEND_SSE2
+        //每次处理4个关节: 载入4个四元数后转置 使每个寄存器的4个通道对应4个关节的同一分量
+        std::size_t BlendRotationsSSE2(std::span<const PoseView> poses, float const * weights, std::size_t count, float * out) {
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 min_norm2 = _mm_set1_ps(c_MinNorm2);
+            const std::size_t blocks = count / 4 * 4;
+            for (std::size_t j = 0; j < blocks; j += 4) {
+                float const * p0 = reinterpret_cast<float const *>(poses[0].rotations.data() + j);
+                __m128 c0 = _mm_loadu_ps(p0), c1 = _mm_loadu_ps(p0 + 4), c2 = _mm_loadu_ps(p0 + 8), c3 = _mm_loadu_ps(p0 + 12);
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+                const __m128 w0 = _mm_set1_ps(weights[0]);
+                __m128 a0 = _mm_mul_ps(c0, w0), a1 = _mm_mul_ps(c1, w0), a2 = _mm_mul_ps(c2, w0), a3 = _mm_mul_ps(c3, w0);
+                for (std::size_t i = 1; i < poses.size(); i++) {
+                    float const * pi = reinterpret_cast<float const *>(poses[i].rotations.data() + j);
+                    __m128 d0 = _mm_loadu_ps(pi), d1 = _mm_loadu_ps(pi + 4), d2 = _mm_loadu_ps(pi + 8), d3 = _mm_loadu_ps(pi + 12);
+                    _MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+                    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, d0), _mm_mul_ps(c1, d1)), _mm_mul_ps(c2, d2)), _mm_mul_ps(c3, d3));
+                    //与基准反向的四元数取负权重 等价于翻转到同一半球
+                    __m128 w = _mm_xor_ps(_mm_set1_ps(weights[i]), _mm_and_ps(_mm_cmplt_ps(dot, zero), sign));
+                    a0 = _mm_add_ps(a0, _mm_mul_ps(d0, w));
+                    a1 = _mm_add_ps(a1, _mm_mul_ps(d1, w));
+                    a2 = _mm_add_ps(a2, _mm_mul_ps(d2, w));
+                    a3 = _mm_add_ps(a3, _mm_mul_ps(d3, w));
+                }
+                __m128 n2 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, a0), _mm_mul_ps(a1, a1)), _mm_mul_ps(a2, a2)), _mm_mul_ps(a3, a3));
+                __m128 valid = _mm_cmpgt_ps(n2, min_norm2);
+                __m128 n = _mm_sqrt_ps(n2);
+                auto select = [&](__m128 a, __m128 fallback) {
+                    return _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(a, n)), _mm_andnot_ps(valid, fallback));
+                };
+                a0 = select(a0, c0);
+                a1 = select(a1, c1);
+                a2 = select(a2, c2);
+                a3 = select(a3, c3);
+                _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+                float * o = out + j * 4;
+                _mm_storeu_ps(o, a0);
+                _mm_storeu_ps(o + 4, a1);
+                _mm_storeu_ps(o + 8, a2);
+                _mm_storeu_ps(o + 12, a3);
+            }
+            return blocks;
+        }
+#endif
+
+        bool SameSize(PoseView const & pose, std::size_t joint_count) {
+            return pose.rotations.size() == joint_count && pose.offsets.size() == joint_count;
+        }
+    } // namespace
+
+    bool BlendPoses(
+        std::span<const PoseView> poses,
+        std::span<const float>    weights,
+        std::span<glm::quat>      rotations,
+        std::span<glm::vec3>      offsets) {
+        if (poses.empty() || weights.size() != poses.size()) return false;
+        const std::size_t joint_count = rotations.size();
+        if (offsets.size() != joint_count) return false;
+        float total = 0.0f;
+        for (std::size_t i = 0; i < poses.size(); i++) {
+            if (! SameSize(poses[i], joint_count) || ! (weights[i] >= 0.0f)) return false;
+            total += weights[i];
+        }
+        if (! (total > 0.0f)) return false;
+
+        //权重先归一化 offset直接得到加权平均 旋转的归一化与之无关
+        constexpr std::size_t c_MaxStackPoses = 16;
+        float                 stack_weights[c_MaxStackPoses];
+        std::vector<float>    heap_weights;
+        float *               normalized = stack_weights;
+        if (poses.size() > c_MaxStackPoses) {
+            heap_weights.resize(poses.size());
+            normalized = heap_weights.data();
+        }
+        for (std::size_t i = 0; i < poses.size(); i++) normalized[i] = weights[i] / total;
+
+        //逐关节的计算只读取同一关节的输入 输出与某个输入重合时也安全
+        float *     out = reinterpret_cast<float *>(rotations.data());
+        std::size_t done = 0;
+#ifdef VCX_POSEBLEND_SSE2
+        done = BlendRotationsSSE2(poses, normalized, joint_count, out);
+#endif
+        BlendRotationsScalar(poses, normalized, done, joint_count, out);
+
+        float * offset_out = reinterpret_cast<float *>(offsets.data());
+        for (std::size_t k = 0; k < joint_count * 3; k++) {
+            float acc = reinterpret_cast<float const *>(poses[0].offsets.data())[k] * normalized[0];
+            for (std::size_t i = 1; i < poses.size(); i++)
+                acc += reinterpret_cast<float const *>(poses[i].offsets.data())[k] * normalized[i];
+            offset_out[k] = acc;
+        }
+        return true;
+    }
+
+    bool BlendPoses(PoseView a, PoseView b, float alpha, std::span<glm::quat> rotations, std::span<glm::vec3> offsets) {
+        alpha = std::clamp(alpha, 0.0f, 1.0f);
+        PoseView const poses[2] { a, b };
+        float const    weights[2] { 1.0f - alpha, alpha };
+        return BlendPoses(poses, weights, rotations, offsets);
+    }
+
+    bool ComputeAdditive(PoseView pose, PoseView reference, std::span<glm::quat> rotations, std::span<glm::vec3> offsets) {
+        const std::size_t joint_count = rotations.size();
+        if (offsets.size() != joint_count || ! SameSize(pose, joint_count) || ! SameSize(reference, joint_count)) return false;
+        for (std::size_t j = 0; j < joint_count; j++) {
+            rotations[j] = glm::conjugate(reference.rotations[j]) * pose.rotations[j];
+            offsets[j] = pose.offsets[j] - reference.offsets[j];
+        }
+        return true;
+    }
+
+    bool ApplyAdditive(PoseView base, PoseView delta, float weight, std::span<glm::quat> rotations, std::span<glm::vec3> offsets) {
+        const std::size_t joint_count = rotations.size();
+        if (offsets.size() != joint_count || ! SameSize(base, joint_count) || ! SameSize(delta, joint_count)) return false;
+        const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+        for (std::size_t j = 0; j < joint_count; j++) {
+            glm::quat d = delta.rotations[j];
+            if (d.w < 0.0f) d = -d;
+            glm::quat scaled = identity * (1.0f - weight) + d * weight;
+            float n2 = glm::dot(scaled, scaled);
+            scaled = n2 > c_MinNorm2 ? scaled / std::sqrt(n2) : identity;
+            rotations[j] = base.rotations[j] * scaled;
+            offsets[j] = base.offsets[j] + delta.offsets[j] * weight;
+        }
+        return true;
+    }
+
+    void CrossfadePlayer::Layer::Advance(float dt) {
+        float duration = PoseSampler::Duration(motion);
+        time = duration > 0.0f ? std::fmod(time + dt, duration) : 0.0f;
+        if (time < 0.0f) time += duration;
+    }
+
+    void CrossfadePlayer::Play(Motion const & motion, float fadeDuration, float startTime) {
+        bool fade = fadeDuration > 0.0f && _current.motion.FrameCount() > 0 && _current.motion.JointCount() == motion.JointCount();
+        if (fade) {
+            std::swap(_previous, _current);
+            _fadeElapsed = 0.0f;
+            _fadeDuration = fadeDuration;
+        } else {
+            _previous = Layer {};
+            _fadeElapsed = 0.0f;
+            _fadeDuration = 0.0f;
+        }
+        _current.motion = motion;
+        _current.sampler.Reset();
+        _current.time = 0.0f;
+        _current.Advance(startTime);
+    }
+
+    void CrossfadePlayer::Stop() {
+        _current = Layer {};
+        _previous = Layer {};
+        _fadeElapsed = 0.0f;
+        _fadeDuration = 0.0f;
+    }
+
+    void CrossfadePlayer::SetTime(float time) {
+        _current.time = 0.0f;
+        _current.Advance(time);
+    }
+
+    float CrossfadePlayer::FadeWeight() const {
+        if (! Fading()) return 1.0f;
+        float t = std::clamp(_fadeElapsed / _fadeDuration, 0.0f, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    void CrossfadePlayer::Advance(float dt) {
+        _current.Advance(dt);
+        if (! Fading()) return;
+        _previous.Advance(dt);
+        _fadeElapsed += dt;
+        if (_fadeElapsed >= _fadeDuration) {
+            //淡入结束 释放旧片段对轨道的引用
+            _previous = Layer {};
+            _fadeElapsed = 0.0f;
+            _fadeDuration = 0.0f;
+        }
+    }
+
+    bool CrossfadePlayer::Evaluate(Skeleton & pose) {
+        if (! _current.sampler.Sample(_current.motion, _current.time, pose)) return false;
+        if (! Fading() || ! _previous.sampler.Sample(_previous.motion, _previous.time, _previousPose)) return true;
+        BlendPoses(LocalPose(_previousPose), LocalPose(pose), FadeWeight(), pose.local_rot, pose.offsets);
+        pose.UpdateGlobal();
+        return true;
+    }
+}
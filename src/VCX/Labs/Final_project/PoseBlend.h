@@ -0,0 +1,73 @@
+#pragma once
+
+#include <span>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "Labs/Final_project/HumanDS.h"
+#include "Labs/Final_project/PoseSampler.h"
+
+namespace VCX::Labs::Final {
+    //局部姿态的扁平视图: 按关节序号排列的局部旋转与offset(含位移通道) 与Skeleton::local_rot/offsets布局相同
+    struct PoseView {
+        std::span<const glm::quat> rotations;
+        std::span<const glm::vec3> offsets;
+    };
+
+    inline PoseView LocalPose(Skeleton const & pose) { return { pose.local_rot, pose.offsets }; }
+
+    //N路加权混合: 旋转先翻转到poses[0]所在半球 加权求和后归一化(nlerp) 每4个关节一组做SIMD
+    //offset按归一化后的权重线性混合; 输出可与某个输入重合
+    //各姿态与输出的关节数需一致、权重数等于姿态数且权重和为正 否则返回false
+    bool BlendPoses(
+        std::span<const PoseView> poses,
+        std::span<const float>    weights,
+        std::span<glm::quat>      rotations,
+        std::span<glm::vec3>      offsets);
+
+    //两路混合 alpha为b的权重
+    bool BlendPoses(PoseView a, PoseView b, float alpha, std::span<glm::quat> rotations, std::span<glm::vec3> offsets);
+
+    //叠加差分: 旋转为inverse(reference) * pose offset为pose - reference
+    //reference通常取叠加片段的首帧 结果可直接作为ApplyAdditive的delta
+    bool ComputeAdditive(PoseView pose, PoseView reference, std::span<glm::quat> rotations, std::span<glm::vec3> offsets);
+
+    //叠加层: 旋转为base * nlerp(单位四元数, delta, weight) offset为base + weight * delta; 输出可与base重合
+    bool ApplyAdditive(PoseView base, PoseView delta, float weight, std::span<glm::quat> rotations, std::span<glm::vec3> offsets);
+
+    //定时交叉淡入淡出: 切换片段时旧片段继续播放 权重在fadeDuration秒内按smoothstep移交给新片段
+    //每帧需对两个片段取样; 淡入期间再次切换时放弃更早的片段 从当前片段开始淡出
+    class CrossfadePlayer {
+    public:
+        //Motion按值保存 轨道数据与调用方共享 关节数与当前片段不同或fadeDuration<=0时直接切换
+        void Play(Motion const & motion, float fadeDuration, float startTime = 0.0f);
+        void Stop();
+
+        //推进两个片段的播放时刻(循环)与淡入进度
+        void Advance(float dt);
+        //写入局部与全局姿态 没有片段时返回false
+        bool Evaluate(Skeleton & pose);
+
+        Motion const & Current() const { return _current.motion; }
+        float          Time() const { return _current.time; }
+        void           SetTime(float time);
+        std::size_t    Frame() const { return _current.sampler.Frame(); }
+        bool           Fading() const { return _fadeDuration > 0.0f; }
+        float          FadeWeight() const;  //新片段的权重
+
+    private:
+        struct Layer {
+            Motion      motion;
+            PoseSampler sampler;
+            float       time { 0.0f };
+
+            void Advance(float dt);
+        };
+
+        Layer    _current;
+        Layer    _previous;
+        float    _fadeElapsed { 0.0f };
+        float    _fadeDuration { 0.0f };   //为0表示没有进行中的淡入
+        Skeleton _previousPose;
+    };
+}
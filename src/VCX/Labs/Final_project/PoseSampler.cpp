@@ -0,0 +1,117 @@
+#include "Labs/Final_project/PoseSampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VCX::Labs::Final {
+    namespace {
+        constexpr float c_DefaultFrameTime = 1.0f / 30.0f;
+        constexpr float c_SlerpThreshold   = 1.0f - 1e-6f;  //cos(夹角)超过该值时改用归一化线性插值
+        constexpr float c_FrameSnap        = 1e-3f;         //与整数帧相差不足该值(帧)时视为恰在该帧 抵消时刻换算的舍入误差
+    } // namespace
+
+    float PoseSampler::FrameTime(Motion const & motion) {
+        return motion.frame_time > 0.0f ? motion.frame_time : c_DefaultFrameTime;
+    }
+
+    float PoseSampler::Duration(Motion const & motion) {
+        const std::size_t frame_count = motion.FrameCount();
+        return frame_count < 2 ? 0.0f : static_cast<float>(frame_count - 1) * FrameTime(motion);
+    }
+
+    void PoseSampler::Reset() {
+        _tracks = nullptr;
+        _frameCount = 0;
+        _frame = 0;
+        _alpha = 0.0f;
+        _intervalBegin = static_cast<std::size_t>(-1);
+        _intervalEnd = 0;
+    }
+
+    void PoseSampler::PrepareInterval(Motion const & motion, std::size_t frame, std::size_t next) {
+        const std::size_t joint_count = motion.JointCount();
+        _target.resize(joint_count);
+        _angle.resize(joint_count);
+        _invSin.resize(joint_count);
+        glm::quat const * q0 = motion.rotations.data() + frame * joint_count;
+        glm::quat const * q1 = motion.rotations.data() + next * joint_count;
+        for (std::size_t j = 0; j < joint_count; j++) {
+            glm::quat target = q1[j];
+            float cos_angle = glm::dot(q0[j], target);
+            if (cos_angle < 0.0f) {
+                target = -target;
+                cos_angle = -cos_angle;
+            }
+            _target[j] = target;
+            if (cos_angle > c_SlerpThreshold) {
+                _angle[j] = 0.0f;
+                _invSin[j] = 0.0f;
+            } else {
+                float angle = std::acos(cos_angle);
+                _angle[j] = angle;
+                _invSin[j] = 1.0f / std::sin(angle);
+            }
+        }
+        _intervalBegin = frame;
+        _intervalEnd = next;
+    }
+
+    bool PoseSampler::Sample(Motion const & motion, float time, Skeleton & pose, Wrap wrap) {
+        const std::size_t frame_count = motion.FrameCount();
+        if (frame_count == 0) return false;
+        if (_tracks != motion.rotations.data() || _frameCount != frame_count) {
+            Reset();
+            _tracks = motion.rotations.data();
+            _frameCount = frame_count;
+        }
+
+        //时刻换算为帧区间与插值系数
+        const float duration = Duration(motion);
+        if (! std::isfinite(time)) time = 0.0f;
+        if (wrap == Wrap::Loop && duration > 0.0f) {
+            time = std::fmod(time, duration);
+            if (time < 0.0f) time += duration;
+        } else {
+            time = std::clamp(time, 0.0f, duration);
+        }
+        float position = time / FrameTime(motion);
+        const float nearest = std::round(position);
+        if (std::fabs(position - nearest) < c_FrameSnap) position = nearest;
+        const std::size_t frame = std::min(static_cast<std::size_t>(position), frame_count - 1);
+        const std::size_t next = std::min(frame + 1, frame_count - 1);
+        float alpha = std::clamp(position - static_cast<float>(frame), 0.0f, 1.0f);
+        if (next == frame) alpha = 0.0f;
+
+        const std::size_t joint_count = motion.JointCount();
+        if (pose.parents != motion.skeleton.parents) pose = motion.skeleton;
+        std::copy_n(motion.skeleton.offsets.begin(), joint_count, pose.offsets.begin());
+
+        glm::quat const * q0 = motion.rotations.data() + frame * joint_count;
+        if (alpha == 0.0f) {
+            std::copy_n(q0, joint_count, pose.local_rot.begin());
+        } else {
+            if (frame != _intervalBegin || next != _intervalEnd) PrepareInterval(motion, frame, next);
+            for (std::size_t j = 0; j < joint_count; j++) {
+                if (_invSin[j] == 0.0f) {
+                    pose.local_rot[j] = glm::normalize(q0[j] * (1.0f - alpha) + _target[j] * alpha);
+                } else {
+                    float w0 = std::sin((1.0f - alpha) * _angle[j]) * _invSin[j];
+                    float w1 = std::sin(alpha * _angle[j]) * _invSin[j];
+                    pose.local_rot[j] = q0[j] * w0 + _target[j] * w1;
+                }
+            }
+        }
+
+        const std::size_t translated_count = motion.translated_joints.size();
+        glm::vec3 const * t0 = motion.translations.data() + frame * translated_count;
+        glm::vec3 const * t1 = motion.translations.data() + next * translated_count;
+        for (std::size_t t = 0; t < translated_count; t++) {
+            glm::vec3 delta = alpha == 0.0f ? t0[t] : glm::mix(t0[t], t1[t], alpha);
+            if (delta != glm::vec3(0.0f)) pose.offsets[motion.translated_joints[t]] += delta;
+        }
+        _frame = frame;
+        _alpha = alpha;
+        pose.UpdateGlobal();
+        return true;
+    }
+}
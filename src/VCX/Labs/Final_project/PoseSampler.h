@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "Labs/Final_project/HumanDS.h"
+
+namespace VCX::Labs::Final {
+    //在任意时刻t对Motion取样: 相邻两帧之间局部旋转做球面插值 位移通道(含根节点位移)做线性插值
+    //同一帧区间内的多次取样复用两端帧的对齐四元数与夹角 高刷新率下每个动画帧区间只做一次acos
+    //t恰为帧时刻时结果与Motion::GetPose逐位一致
+    class PoseSampler {
+    public:
+        enum class Wrap {
+            Clamp,  //t限制在[0, Duration]
+            Loop,   //t对Duration取模 末帧与首帧视为同一时刻
+        };
+
+        //frame_time无效时按30fps播放
+        static float FrameTime(Motion const & motion);
+        //首帧到末帧的时长 单帧片段为0
+        static float Duration(Motion const & motion);
+
+        //pose可跨调用复用 关节数不变时没有堆分配 motion没有帧时返回false
+        bool Sample(Motion const & motion, float time, Skeleton & pose, Wrap wrap = Wrap::Loop);
+        //使缓存的帧区间失效 载入新的Motion或改写轨道后调用 轨道地址或帧数变化时也会自动失效
+        void Reset();
+
+        //最近一次取样所在区间的起始帧与区间内的插值系数
+        std::size_t Frame() const { return _frame; }
+        float       Alpha() const { return _alpha; }
+
+    private:
+        void PrepareInterval(Motion const & motion, std::size_t frame, std::size_t next);
+
+        void const *           _tracks { nullptr };  //缓存对应的旋转轨道 用于检测Motion是否更换
+        std::size_t            _frameCount { 0 };
+        std::size_t            _frame { 0 };
+        float                  _alpha { 0.0f };
+        std::size_t            _intervalBegin { static_cast<std::size_t>(-1) };  //下列缓存对应的帧区间
+        std::size_t            _intervalEnd { 0 };
+        std::vector<glm::quat> _target;    //与起始帧同半球的终止帧旋转
+        std::vector<float>     _angle;     //两端旋转的夹角
+        std::vector<float>     _invSin;    //1 / sin(夹角) 夹角过小时为0 改用归一化线性插值
+    };
+}
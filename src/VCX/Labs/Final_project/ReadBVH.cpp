@@ -1,13 +1,34 @@
 ﻿#include "ReadBVH.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "Engine/loader.h"
+#include "Labs/Final_project/ChannelEvaluator.h"
+#include "Labs/Final_project/MotionCache.h"
+#include "Labs/Final_project/Parallel.h"
+
+//较早的libc++(Apple Clang 15之前)不支持浮点数的std::from_chars 退回指定C locale的strtof_l
+//全局locale的小数点可能是',' 不能直接用strtof
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define VCX_BVH_FLOAT_FROM_CHARS 1
+#elif defined(__APPLE__)
+#include <xlocale.h>
+#else
+#include <locale.h>
+#endif
+
 namespace VCX::Labs::Final {
 namespace {
 
-    BVHChannelType ParseChannelType(const std::string & token) {
+    BVHChannelType ParseChannelType(std::string_view token) {
         if (token == "Xposition") return BVHChannelType::Xposition;
         if (token == "Yposition") return BVHChannelType::Yposition;
         if (token == "Zposition") return BVHChannelType::Zposition;
@@ -16,43 +37,139 @@ namespace {
         return BVHChannelType::Zrotation;
     }
 
-    void ReadFloat3(std::istream & in, glm::vec3 & out) {
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    //解析[first, last)开头的浮点数 成功时返回数值之后的位置 失败返回nullptr
+    char const * ParseFloat(char const * first, char const * last, float & v) {
+#ifdef VCX_BVH_FLOAT_FROM_CHARS
+        auto [ptr, ec] = std::from_chars(first, last, v);
+        return ec == std::errc() ? ptr : nullptr;
+#else
+        //strtof要求以'\0'结尾 把数值部分复制到栈上
+        char buffer[64];
+        std::size_t n = 0;
+        while (first + n < last && n + 1 < sizeof(buffer)) {
+            char c = first[n];
+            if (! ((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E')) break;
+            buffer[n++] = c;
+        }
+        buffer[n] = '\0';
+        char * end = buffer;
+#ifdef _WIN32
+        static _locale_t const c_locale = _create_locale(LC_NUMERIC, "C");
+        v = _strtof_l(buffer, &end, c_locale);
+#else
+        static locale_t const c_locale = newlocale(LC_NUMERIC_MASK, "C", nullptr);
+        v = strtof_l(buffer, &end, c_locale);
+#endif
+        return end == buffer ? nullptr : first + (end - buffer);
+#endif
+    }
+
+    //基于std::istream逐token读取 token在下一次读取前有效
+    class StreamReader {
+    public:
+        explicit StreamReader(std::istream & in): _in(in) {}
+
+        bool Token(std::string_view & token) {
+            if (! (_in >> _buffer)) return false;
+            token = _buffer;
+            return true;
+        }
+        bool Float(float & v) { return static_cast<bool>(_in >> v); }
+        bool Size(std::size_t & v) { return static_cast<bool>(_in >> v); }
+
+    private:
+        std::istream & _in;
+        std::string    _buffer;
+    };
+
+    //直接在内存块上扫描 数值用std::from_chars解析 不支持时见ParseFloat 两者都与全局locale无关
+    class BufferReader {
+    public:
+        BufferReader(char const * begin, char const * end): _cur(begin), _end(end) {}
+
+        bool Token(std::string_view & token) {
+            SkipSpace();
+            char const * start = _cur;
+            while (_cur < _end && ! IsSpace(*_cur)) _cur++;
+            token = std::string_view(start, static_cast<std::size_t>(_cur - start));
+            return ! token.empty();
+        }
+        bool Float(float & v) {
+            SkipSpace();
+            if (_cur < _end && *_cur == '+') _cur++;
+            char const * ptr = ParseFloat(_cur, _end, v);
+            if (! ptr) return false;
+            _cur = ptr;
+            return true;
+        }
+        bool Size(std::size_t & v) {
+            SkipSpace();
+            auto [ptr, ec] = std::from_chars(_cur, _end, v);
+            if (ec != std::errc()) return false;
+            _cur = ptr;
+            return true;
+        }
+        bool AtEnd() {
+            SkipSpace();
+            return _cur >= _end;
+        }
+        char const * Position() const { return _cur; }
+
+    private:
+        void SkipSpace() {
+            while (_cur < _end && IsSpace(*_cur)) _cur++;
+        }
+
+        char const * _cur;
+        char const * _end;
+    };
+
+    template<typename Reader>
+    void ReadFloat3(Reader & in, glm::vec3 & out) {
         float x = 0.0f;
         float y = 0.0f;
         float z = 0.0f;
-        in >> x >> y >> z;
+        in.Float(x);
+        in.Float(y);
+        in.Float(z);
         out = glm::vec3(x, y, z);
     }
 
-    int ParseEndSite(std::istream & in,
+    template<typename Reader>
+    int ParseEndSite(Reader & in,
                      HumanDS & human,
                      const JointPtr & parent,
                      std::vector<JointPtr> & joints) {
-        std::string token;
-        in >> token; // "{"
+        std::string_view token;
+        in.Token(token); // "{"
         auto joint = human.CreateJoint("EndSite", true);
         if (parent) human.AttachChild(parent, joint);
 
-        in >> token; // "OFFSET"
+        in.Token(token); // "OFFSET"
         glm::vec3 offset(0.0f);
         ReadFloat3(in, offset);
         human.SetJointOffset(joint, offset);
 
-        in >> token; // "}"
+        in.Token(token); // "}"
         int index = static_cast<int>(joints.size());
         joints.push_back(joint);
         return index;
     }
 
-    int ParseJoint(std::istream & in,
+    template<typename Reader>
+    int ParseJoint(Reader & in,
                    HumanDS & human,
                    const JointPtr & parent,
                    const std::string & name,
                    bool is_root,
                    std::vector<BVHChannel> & channels,
                    std::vector<JointPtr> & joints) {
-        std::string token;
-        in >> token; // "{"
+        std::string_view token;
+        in.Token(token); // "{"
 
         auto joint = human.CreateJoint(name);
         if (is_root) human.SetRoot(joint);
@@ -61,26 +178,25 @@ namespace {
         int index = static_cast<int>(joints.size());
         joints.push_back(joint);
 
-        while (in >> token) {
+        while (in.Token(token)) {
             if (token == "OFFSET") {
                 glm::vec3 offset(0.0f);
                 ReadFloat3(in, offset);
                 human.SetJointOffset(joint, offset);
             } else if (token == "CHANNELS") {
-                int count = 0;
-                in >> count;
-                for (int i = 0; i < count; i++) {
-                    std::string chan;
-                    in >> chan;
+                std::size_t count = 0;
+                in.Size(count);
+                for (std::size_t i = 0; i < count; i++) {
+                    std::string_view chan;
+                    in.Token(chan);
                     channels.push_back(BVHChannel { index, ParseChannelType(chan) });
                 }
             } else if (token == "JOINT") {
-                std::string child_name;
-                in >> child_name;
+                in.Token(token);
+                std::string child_name(token);
                 ParseJoint(in, human, joint, child_name, false, channels, joints);
             } else if (token == "End") {
-                std::string site;
-                in >> site; // "Site"
+                in.Token(token); // "Site"
                 ParseEndSite(in, human, joint, joints);
             } else if (token == "}") {
                 return index;
@@ -89,83 +205,153 @@ namespace {
         return index;
     }
 
+    //解析HIERARCHY段与MOTION段的帧头 结束时reader位于第一帧数据之前
+    template<typename Reader>
+    bool ParseHeader(Reader & in, HumanDS & human, BVHClip & clip) {
+        std::string_view token;
+        if (! in.Token(token) || token != "HIERARCHY") return false;
+        in.Token(token); // ROOT
+        in.Token(token);
+        std::string root_name(token);
+
+        std::vector<JointPtr> joints;
+        ParseJoint(in, human, nullptr, root_name, true, clip.channels, joints);
+
+        if (! in.Token(token) || token != "MOTION") return false;
+        in.Token(token); // Frames:
+        in.Size(clip.frame_count);
+        in.Token(token); // Frame
+        in.Token(token); // Time:
+        in.Float(clip.frame_time);
+        return true;
+    }
+
+    //对[begin, end)中每个含非空白字符的行调用func(line_begin, line_end)
+    template<typename Func>
+    void ForEachDataLine(char const * begin, char const * end, Func && func) {
+        while (begin < end) {
+            auto eol = static_cast<char const *>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+            if (! eol) eol = end;
+            if (std::find_if_not(begin, eol, IsSpace) != eol) func(begin, eol);
+            begin = eol == end ? end : eol + 1;
+        }
+    }
+
+    constexpr std::size_t c_MinChunkBytes = 64 * 1024;
+    constexpr std::size_t c_MinDecodeFrames = 256;  //每个线程至少解码的帧数 短片段不值得分发
+
+    //MOTION段每行一帧: 按行边界把数据块切成若干段 先并行统计各段行数得到起始帧号 再并行解析
+    //行数或每行数值个数与帧头不符时返回false 由调用方退回逐token解析
+    bool ParseFramesByLines(char const * begin, char const * end, BVHClip & clip, unsigned workers) {
+        const std::size_t channel_count = clip.channels.size();
+        const std::size_t size = static_cast<std::size_t>(end - begin);
+        const std::size_t chunk_count = std::clamp<std::size_t>(size / c_MinChunkBytes, 1, ResolveWorkerCount(workers));
+
+        std::vector<char const *> bounds(chunk_count + 1, end);
+        bounds[0] = begin;
+        for (std::size_t c = 1; c < chunk_count; c++) {
+            char const * p = std::max(begin + size * c / chunk_count, bounds[c - 1]);
+            auto eol = static_cast<char const *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+            bounds[c] = eol ? eol + 1 : end;
+        }
+
+        std::vector<std::size_t> first_frame(chunk_count + 1, 0);
+        ParallelFor(chunk_count, 1, workers, [&](std::size_t b, std::size_t e) {
+            for (std::size_t c = b; c < e; c++) {
+                std::size_t lines = 0;
+                ForEachDataLine(bounds[c], bounds[c + 1], [&](char const *, char const *) { lines++; });
+                first_frame[c + 1] = lines;
+            }
+        });
+        for (std::size_t c = 0; c < chunk_count; c++) first_frame[c + 1] += first_frame[c];
+        if (first_frame[chunk_count] != clip.frame_count) return false;
+
+        std::atomic_bool ok = true;
+        ParallelFor(chunk_count, 1, workers, [&](std::size_t b, std::size_t e) {
+            for (std::size_t c = b; c < e; c++) {
+                float * out = clip.frames.data() + first_frame[c] * channel_count;
+                ForEachDataLine(bounds[c], bounds[c + 1], [&](char const * line_begin, char const * line_end) {
+                    BufferReader line(line_begin, line_end);
+                    for (std::size_t i = 0; i < channel_count; i++) {
+                        if (! line.Float(out[i])) ok.store(false);
+                    }
+                    if (! line.AtEnd()) ok.store(false);
+                    out += channel_count;
+                });
+            }
+        });
+        return ok.load();
+    }
+
 } // namespace
 
-bool LoadBVH(const std::string & path, HumanDS & human, BVHClip & clip) {
-    std::ifstream file(path);
-    std::string token;
+bool LoadBVH(const std::string & path, HumanDS & human, BVHClip & clip, unsigned workers) {
+    auto const bytes = Engine::LoadBytes(path);
+    if (bytes.empty()) return false;
+    char const * begin = reinterpret_cast<char const *>(bytes.data());
+    char const * end = begin + bytes.size();
+
+    clip = BVHClip {};
+    BufferReader in(begin, end);
+    if (! ParseHeader(in, human, clip)) return false;
 
-    file >> token; // HIERARCHY
-    file >> token; // ROOT
-    std::string root_name;
-    file >> root_name;
+    const std::size_t total_values = clip.frame_count * clip.channels.size();
+    clip.frames.assign(total_values, 0.0f);
+    if (! ParseFramesByLines(in.Position(), end, clip, workers)) {
+        std::fill(clip.frames.begin(), clip.frames.end(), 0.0f);
+        for (std::size_t i = 0; i < total_values; i++) {
+            if (! in.Float(clip.frames[i])) break;
+        }
+    }
+    return true;
+}
 
-    std::vector<JointPtr> joints;
-    ParseJoint(file, human, nullptr, root_name, true, clip.channels, joints);
+bool LoadBVHStream(const std::string & path, HumanDS & human, BVHClip & clip) {
+    std::ifstream file(path);
+    if (! file) return false;
 
-    file >> token; // MOTION
-    file >> token; // Frames:
-    file >> clip.frame_count;
-    file >> token; // Frame
-    file >> token; // Time:
-    file >> clip.frame_time;
+    clip = BVHClip {};
+    StreamReader in(file);
+    if (! ParseHeader(in, human, clip)) return false;
 
-    const std::size_t channel_count = clip.channels.size();
-    const std::size_t total_values = clip.frame_count * channel_count;
+    const std::size_t total_values = clip.frame_count * clip.channels.size();
     clip.frames.resize(total_values, 0.0f);
     for (std::size_t i = 0; i < total_values; i++) {
-        file >> clip.frames[i];
+        if (! in.Float(clip.frames[i])) break;
     }
-
     return true;
 }
 
-bool LoadBVHAsMotion(const std::string & path, Motion & out) {
+bool LoadBVHAsMotion(const std::string & path, Motion & out, bool use_cache, unsigned workers) {
+    if (use_cache && LoadMotionCache(path, out)) return true;
+
     HumanDS base;
     BVHClip clip;
-    if (! LoadBVH(path, base, clip)) return false;
+    if (! LoadBVH(path, base, clip, workers)) return false;
 
-    auto base_joints = base.DFSJoints();
-    const std::size_t joint_count = base_joints.size();
-    const std::size_t channel_count = clip.channels.size();
+    out.skeleton = base.ToSkeleton();
+    const std::size_t joint_count = out.skeleton.JointCount();
 
-    out.frames.clear();
-    out.frames.reserve(clip.frame_count);
-    out.frame_time = clip.frame_time;
+    //静止姿态: 局部旋转为单位四元数
+    std::fill(out.skeleton.local_rot.begin(), out.skeleton.local_rot.end(), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    out.skeleton.UpdateGlobal();
 
-    for (std::size_t f = 0; f < clip.frame_count; f++) {
-        HumanDS frame = base.Clone();
-        auto frame_joints = frame.DFSJoints();
-
-        std::vector<glm::vec3> pos_delta(joint_count, glm::vec3(0.0f));
-        std::vector<glm::quat> rot_quat(joint_count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
-
-        for (std::size_t c = 0; c < channel_count; c++) {
-            float v = clip.frames[f * channel_count + c];
-            const auto & ch = clip.channels[c];
-            int idx = ch.joint_index;
-            if (idx < 0 || static_cast<std::size_t>(idx) >= joint_count) continue;
-            if (ch.type == BVHChannelType::Xrotation) rot_quat[idx] = rot_quat[idx] * glm::angleAxis(glm::radians(v), glm::vec3(1.0f, 0.0f, 0.0f));
-            if (ch.type == BVHChannelType::Yrotation) rot_quat[idx] = rot_quat[idx] * glm::angleAxis(glm::radians(v), glm::vec3(0.0f, 1.0f, 0.0f));
-            if (ch.type == BVHChannelType::Zrotation) rot_quat[idx] = rot_quat[idx] * glm::angleAxis(glm::radians(v), glm::vec3(0.0f, 0.0f, 1.0f));
-            if (ch.type == BVHChannelType::Xposition) pos_delta[idx].x = v;
-            if (ch.type == BVHChannelType::Yposition) pos_delta[idx].y = v;
-            if (ch.type == BVHChannelType::Zposition) pos_delta[idx].z = v;
-        }
-
-        for (std::size_t i = 0; i < joint_count; i++) {
-            auto & joint = frame_joints[i];
-            glm::vec3 base_offset = base.GetJointOffset(base_joints[i]);
-            if (pos_delta[i] != glm::vec3(0.0f)) {
-                frame.SetJointOffset(joint, base_offset + pos_delta[i]);
-            }
-            frame.SetJointRotationQuat(joint, rot_quat[i]);
-        }
+    //通道布局只编译一次 解码时每帧按关节组流式求值
+    BVHChannelEvaluator evaluator;
+    evaluator.Compile(clip.channels, joint_count);
+    out.translated_joints.assign(evaluator.TranslatedJoints().begin(), evaluator.TranslatedJoints().end());
+    const std::size_t translated_count = out.translated_joints.size();
 
-        frame.UpdateGlobal();
-        out.frames.push_back(frame);
-    }
+    out.frame_time = clip.frame_time;
+    std::vector<glm::quat> rotations(clip.frame_count * joint_count);
+    std::vector<glm::vec3> translations(clip.frame_count * translated_count);
+    //各帧互不依赖: 按帧区间分给线程池 每个线程写入预分配轨道中自己的区间 结果与单线程逐位一致
+    ParallelFor(clip.frame_count, c_MinDecodeFrames, workers, [&](std::size_t b, std::size_t e) {
+        evaluator.Decode(clip.frames, b, e, rotations, translations);
+    });
+    out.SetTracks(std::move(translations), std::move(rotations));
 
+    if (use_cache) SaveMotionCache(path, out);
     return true;
 }
 
@@ -32,8 +32,13 @@ namespace VCX::Labs::Final{
         std::vector<float> frames;
     };
 
-    bool LoadBVH(const std::string & path, HumanDS & human, BVHClip & clip);
-    bool LoadBVHAsMotion(const std::string & path, Motion & out);
+    //整块读入文件后扫描解析 数值用std::from_chars解析 MOTION段按行切分到workers个线程(0为硬件并发数)
+    bool LoadBVH(const std::string & path, HumanDS & human, BVHClip & clip, unsigned workers = 0);
+    //基于std::ifstream逐token解析 作为基准对比的参考实现
+    bool LoadBVHStream(const std::string & path, HumanDS & human, BVHClip & clip);
+    //use_cache为true时优先映射同目录下的二进制缓存(见MotionCache.h) 缓存失效则解析文本并重写缓存
+    //解析与逐帧解码均按帧区间分到workers个线程(0为硬件并发数 1为单线程) 结果与线程数无关
+    bool LoadBVHAsMotion(const std::string & path, Motion & out, bool use_cache = true, unsigned workers = 0);
 
 }
 
@@ -9,11 +9,18 @@
 #include "ReadBVH.h"
 
 namespace VCX::Labs::Final::Skinning {
+    enum class DiffusionMethod {
+        Jacobi,  //逐关节显式迭代 锚定点按关节分别固定
+        Sparse,  //稀疏Cholesky隐式求解 锚定点取所有关节的并集 分解一次供全部关节回代
+    };
+
     struct Options {
+        DiffusionMethod diffusion = DiffusionMethod::Sparse;
         int   heatIterations = 20;
         float heatLambda = 0.6f;
         float heatAnchorRadius = 0.05f;
         int   componentMaxJoints = 2; //每个连通分块最多允许的骨骼参与计算数量
+        unsigned workerCount = 0;     //构建权重的线程数 0表示使用硬件并发数 结果与线程数无关
     };
 
     struct Influence {
@@ -21,6 +28,23 @@ namespace VCX::Labs::Final::Skinning {
         std::array<float, 4> weights;
     };
 
+    //bindPose/pose 需已调用 Skeleton::UpdateGlobal()
+    bool BuildSkinningData(
+        Engine::SurfaceMesh const & bindMesh,
+        Skeleton const & bindPose,
+        float skeletonScale,
+        Options const & options,
+        std::vector<Influence> & weights,
+        std::vector<glm::mat4> & invBind);
+
+    bool ApplySkinning(
+        Engine::SurfaceMesh const & bindMesh,
+        Skeleton const & pose,
+        float skeletonScale,
+        std::vector<Influence> const & weights,
+        std::vector<glm::mat4> const & invBind,
+        Engine::SurfaceMesh & outMesh);
+
     bool BuildSkinningData(
         Engine::SurfaceMesh const & bindMesh,
         Motion const & motion,
@@ -0,0 +1,551 @@
+#include "Labs/Final_project/SkinningBinder.h"
+#include "Labs/Final_project/CapsuleGrid.h"
+#include "Labs/Final_project/Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace VCX::Labs::Final::Skinning {
+namespace {
+    constexpr int   kMaxInfluence = 4;      //最多k个关节可以影响一个顶点
+    constexpr float kWeightRadius = 0.5f;   //距离衰减影响半径
+    constexpr float kFalloffPower = 2.0f;   //衰减指数幂指数
+    constexpr float kMinWeight    = 0.02f;  //最终选择top-k时的最小权重阈值 若小 舍去
+
+    //每个阶段直接依赖的阶段
+    constexpr std::array<std::uint32_t, static_cast<std::size_t>(BindStage::Count)> c_StageInputs = [] {
+        auto bit = [](BindStage s) { return 1u << static_cast<unsigned>(s); };
+        std::array<std::uint32_t, static_cast<std::size_t>(BindStage::Count)> inputs {};
+        inputs[static_cast<std::size_t>(BindStage::Components)]     = bit(BindStage::Topology);
+        inputs[static_cast<std::size_t>(BindStage::BoneAssignment)] = bit(BindStage::Components) | bit(BindStage::Skeleton);
+        inputs[static_cast<std::size_t>(BindStage::InitialField)]   = bit(BindStage::BoneAssignment);
+        inputs[static_cast<std::size_t>(BindStage::Anchors)]        = bit(BindStage::Components) | bit(BindStage::Skeleton);
+        inputs[static_cast<std::size_t>(BindStage::Factorization)]  = bit(BindStage::Topology) | bit(BindStage::Anchors);
+        inputs[static_cast<std::size_t>(BindStage::Diffusion)]      = bit(BindStage::InitialField) | bit(BindStage::Anchors) | bit(BindStage::Factorization);
+        inputs[static_cast<std::size_t>(BindStage::TopK)]           = bit(BindStage::Diffusion) | bit(BindStage::BoneAssignment);
+        return inputs;
+    }();
+} // namespace
+
+    std::vector<std::vector<int>> BuildAdjacency(Engine::SurfaceMesh const & mesh) {
+        std::vector<std::vector<int>> neighbors(mesh.Positions.size());
+        auto add_edge = [&](std::size_t a, std::size_t b) {
+            if (a >= neighbors.size() || b >= neighbors.size())
+                return;
+            neighbors[a].push_back(static_cast<int>(b));
+            neighbors[b].push_back(static_cast<int>(a));
+        };
+        for (std::size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+            std::size_t i0 = static_cast<std::size_t>(mesh.Indices[i + 0]);
+            std::size_t i1 = static_cast<std::size_t>(mesh.Indices[i + 1]);
+            std::size_t i2 = static_cast<std::size_t>(mesh.Indices[i + 2]);
+            add_edge(i0, i1);
+            add_edge(i1, i2);
+            add_edge(i2, i0);
+        }
+        for (auto & list : neighbors) {
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+        }
+        return neighbors;
+    } //得到顶点的邻接图
+
+    std::pair<std::vector<int>, std::vector<std::vector<int>>> BuildComponents(
+        std::vector<std::vector<int>> const & neighbors) {
+        std::vector<int> comp_id(neighbors.size(), -1);
+        std::vector<std::vector<int>> components;
+        int current = 0;
+        for (std::size_t v = 0; v < neighbors.size(); v++) {
+            if (comp_id[v] != -1)
+                continue;
+            components.emplace_back();
+            std::vector<int> stack;
+            stack.push_back(static_cast<int>(v));
+            comp_id[v] = current;
+            while (!stack.empty()) {
+                int cur = stack.back();
+                stack.pop_back();
+                components[static_cast<std::size_t>(current)].push_back(cur);
+                for (int nb : neighbors[static_cast<std::size_t>(cur)]) {
+                    if (comp_id[static_cast<std::size_t>(nb)] != -1)
+                        continue;
+                    comp_id[static_cast<std::size_t>(nb)] = current;
+                    stack.push_back(nb);
+                }
+            }
+            current++;
+        }
+        return { comp_id, components };
+    }  //DFS 由于dancing对应的mesh是n个连通分量组成的 因此遍历并得到连通分量
+
+    float DistanceToSegment(glm::vec3 const & p, glm::vec3 const & a, glm::vec3 const & b, float & t_out) {
+        glm::vec3 ab = b - a;
+        float ab_len2 = glm::dot(ab, ab);
+        if (ab_len2 <= 1e-8f) {
+            t_out = 0.0f;
+            return glm::length(p - a);
+        }
+        float t = glm::dot(p - a, ab) / ab_len2;
+        t = std::clamp(t, 0.0f, 1.0f);
+        t_out = t;
+        glm::vec3 proj = a + t * ab;
+        return glm::length(p - proj);
+    }  //p为网格顶点  a b 为骨骼两端点  t_out为p到ab的投影点在ab中的比例  return p到ab的最短距离
+
+    //按固定大小的顶点块并行调用emit(begin, end, push) push(j, v, w)写入一个非零项 每个顶点对同一关节至多写一次
+    //再按块的顺序归并成逐关节的稀疏列 列内顶点序号升序 分块与线程数无关
+    template<typename Emit>
+    std::vector<WeightColumn> GatherColumns(std::size_t vcount, std::size_t jcount, unsigned workers, Emit && emit) {
+        constexpr std::size_t c_Block = 4096;
+        struct Entry {
+            std::uint32_t joint;
+            std::uint32_t vertex;
+            float         value;
+        };
+        std::vector<std::vector<Entry>> parts((vcount + c_Block - 1) / c_Block);
+        ParallelFor(parts.size(), 1, workers, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                auto & part = parts[b];
+                emit(b * c_Block, std::min(vcount, (b + 1) * c_Block), [&part](std::size_t j, std::size_t v, float w) {
+                    part.push_back({ static_cast<std::uint32_t>(j), static_cast<std::uint32_t>(v), w });
+                });
+            }
+        });
+        std::vector<std::size_t> counts(jcount, 0);
+        for (auto const & part : parts)
+            for (auto const & e : part) counts[e.joint]++;
+        std::vector<WeightColumn> columns(jcount);
+        for (std::size_t j = 0; j < jcount; j++) {
+            columns[j].vertices.reserve(counts[j]);
+            columns[j].values.reserve(counts[j]);
+        }
+        for (auto & part : parts) {
+            for (auto const & e : part) {
+                columns[e.joint].vertices.push_back(e.vertex);
+                columns[e.joint].values.push_back(e.value);
+            }
+            std::vector<Entry>().swap(part);
+        }
+        return columns;
+    }
+
+    char const * BindStageName(BindStage stage) {
+        switch (stage) {
+        case BindStage::Topology:       return "Topology";
+        case BindStage::Components:     return "Components";
+        case BindStage::Skeleton:       return "Skeleton";
+        case BindStage::BoneAssignment: return "Bone Assignment";
+        case BindStage::InitialField:   return "Initial Field";
+        case BindStage::Anchors:        return "Anchors";
+        case BindStage::Factorization:  return "Factorization";
+        case BindStage::Diffusion:      return "Diffusion";
+        case BindStage::TopK:           return "Top-K";
+        default:                        return "Unknown";
+        }
+    }
+
+    void SkinningBinder::Invalidate(BindStage stage) {
+        std::uint32_t mask = 1u << static_cast<unsigned>(stage);
+        for (std::size_t s = static_cast<std::size_t>(stage) + 1; s < c_StageInputs.size(); s++)
+            if (c_StageInputs[s] & mask) mask |= 1u << s;
+        _valid &= ~mask;
+    }
+
+    void SkinningBinder::Clear() {
+        *this = SkinningBinder();
+    }
+
+    void SkinningBinder::SetMesh(Engine::SurfaceMesh const & bindMesh) {
+        if (bindMesh.Indices != _mesh.Indices || bindMesh.Positions.size() != _mesh.Positions.size()) {
+            _mesh.Indices = bindMesh.Indices;
+            _mesh.Positions = bindMesh.Positions;
+            Invalidate(BindStage::Topology);
+        } else if (bindMesh.Positions != _mesh.Positions) {
+            _mesh.Positions = bindMesh.Positions;
+            Invalidate(BindStage::Components);
+        }
+    }
+
+    void SkinningBinder::SetSkeleton(Skeleton const & bindPose, float skeletonScale) {
+        auto segments = bindPose.GetSegmentIndices();
+        if (bindPose.global_trans == _jointPositions && bindPose.global_rot == _jointRotations
+            && skeletonScale == _skeletonScale && segments == _segments)
+            return;
+        _jointPositions = bindPose.global_trans;
+        _jointRotations = bindPose.global_rot;
+        _segments = std::move(segments);
+        _skeletonScale = skeletonScale;
+        Invalidate(BindStage::Skeleton);
+    }
+
+    bool SkinningBinder::Build(
+        Options const &          options,
+        std::vector<Influence> & weights,
+        std::vector<glm::mat4> & invBind,
+        StageCallback const &    onStage,
+        CancelCheck const &      cancelled) {
+        weights.clear();
+        invBind.clear();
+        _executed = 0;
+
+        if (_mesh.Positions.empty() || _jointPositions.empty())
+            return false;
+
+        if (! _hasOptions || options.componentMaxJoints != _options.componentMaxJoints)
+            Invalidate(BindStage::BoneAssignment);
+        if (! _hasOptions || options.heatAnchorRadius != _options.heatAnchorRadius)
+            Invalidate(BindStage::Anchors);
+        if (! _hasOptions || options.heatLambda != _options.heatLambda || options.heatIterations != _options.heatIterations)
+            Invalidate(BindStage::Factorization);
+        if (! _hasOptions || options.diffusion != _options.diffusion)
+            Invalidate(BindStage::Diffusion);
+        _options = options;
+        _hasOptions = true;
+
+        const unsigned workers = options.workerCount;
+        const bool diffuse = options.heatIterations > 0;
+        const bool sparse = diffuse && options.diffusion == DiffusionMethod::Sparse;
+        //锚定点与分解只在扩散需要时计算 未计算时保持失效 之后需要时再补算
+        //返回bool的阶段可在中途被取消 此时不标记为有效
+        auto run = [&](BindStage stage, auto && func) {
+            if (Valid(stage)) return true;
+            if (onStage && ! onStage(stage)) return false;
+            if constexpr (std::is_same_v<decltype(func()), bool>) {
+                if (! func()) return false;
+            } else {
+                func();
+            }
+            _valid |= 1u << static_cast<unsigned>(stage);
+            _executed |= 1u << static_cast<unsigned>(stage);
+            return true;
+        };
+        bool completed = run(BindStage::Topology, [&] { RunTopology(); })
+            && run(BindStage::Components, [&] { RunComponents(); })
+            && run(BindStage::Skeleton, [&] { RunSkeleton(); })
+            && run(BindStage::BoneAssignment, [&] { RunBoneAssignment(options); })
+            && run(BindStage::InitialField, [&] { RunInitialField(workers); })
+            && (! diffuse || run(BindStage::Anchors, [&] { RunAnchors(options, workers); }))
+            && (! sparse || run(BindStage::Factorization, [&] { RunFactorization(options); }))
+            && run(BindStage::Diffusion, [&] { return RunDiffusion(options, workers, cancelled); })
+            && run(BindStage::TopK, [&] { RunTopK(workers); });
+        if (! completed)
+            return false;
+
+        weights = _weights;
+        invBind = _invBind;
+        return true;
+    }
+
+    void SkinningBinder::RunTopology() {
+        _neighbors = BuildAdjacency(_mesh);  //邻接表
+    }
+
+    void SkinningBinder::RunComponents() {
+        auto component_info = BuildComponents(_neighbors);  //连通分量
+        _compId = std::move(component_info.first);  //id
+        auto const & components = component_info.second;  //组成
+
+        _compCenters.assign(components.size(), glm::vec3(0.0f));   //计算连通分量的中心值 用于与骨骼对应
+        std::vector<int> comp_counts(components.size(), 0);
+        for (std::size_t c = 0; c < components.size(); c++) {
+            for (int v : components[c]) {
+                _compCenters[c] += _mesh.Positions[static_cast<std::size_t>(v)];
+                comp_counts[c] += 1;
+            }
+            if (comp_counts[c] > 0)
+                _compCenters[c] /= static_cast<float>(comp_counts[c]);
+        }
+    }
+
+    void SkinningBinder::RunSkeleton() {
+        const std::size_t joint_count = _jointPositions.size();
+        _bindPositions.resize(joint_count);
+        _invBind.resize(joint_count);
+        for (std::size_t i = 0; i < joint_count; i++) {
+            glm::vec3 pos = _jointPositions[i] * _skeletonScale; //关节的全局位置*尺度
+            glm::quat rot = _jointRotations[i];
+            glm::mat4 bind = glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(rot);  //由原点的变换矩阵
+            _invBind[i] = glm::inverse(bind);  //mesh的顶点变换到关节附近的空间中
+            _bindPositions[i] = pos;
+        }
+    }
+
+    void SkinningBinder::RunBoneAssignment(Options const & options) {
+        const std::size_t jcount = _bindPositions.size();
+        auto const & segments = _segments;
+        auto & allowed_joints = _allowedJoints;
+        allowed_joints.clear();
+        if (options.componentMaxJoints > 0 && !segments.empty()) {
+            allowed_joints.assign(_compCenters.size(), std::vector<unsigned char>(jcount, 0));
+            int cap = std::min(options.componentMaxJoints, static_cast<int>(jcount));
+            for (std::size_t c = 0; c < _compCenters.size(); c++) {
+                std::vector<std::pair<float, std::size_t>> seg_dists;
+                seg_dists.reserve(segments.size());  //计算到每一个骨骼的距离
+                for (std::size_t s = 0; s < segments.size(); s++) {
+                    auto const & seg = segments[s];
+                    if (seg.first >= jcount || seg.second >= jcount)
+                        continue;
+                    float t = 0.0f;
+                    float dist = DistanceToSegment(_compCenters[c], _bindPositions[seg.first], _bindPositions[seg.second], t);
+                    seg_dists.emplace_back(dist, s);  //s为骨骼编号
+                }
+                std::sort(seg_dists.begin(), seg_dists.end(),
+                          [](auto const & a, auto const & b) { return a.first < b.first; });  //排序
+                int count = 0;
+                for (auto const & item : seg_dists) {
+                    auto const & seg = segments[item.second];
+                    if (seg.first < jcount && allowed_joints[c][seg.first] == 0) {
+                        allowed_joints[c][seg.first] = 1;
+                        count++;
+                    }
+                    if (seg.second < jcount && allowed_joints[c][seg.second] == 0) {
+                        allowed_joints[c][seg.second] = 1;
+                        count++;
+                    }
+                    if (count >= cap)
+                        break;
+                }
+                if (count == 0)
+                    std::fill(allowed_joints[c].begin(), allowed_joints[c].end(), 1);
+            }
+        }
+    }
+
+    //各阶段按关节或顶点划分 线程间不共享写入位置 结果与线程数无关
+    //权重场按关节存为稀疏列 内存随非零支撑而非jcount * vcount增长
+    void SkinningBinder::RunInitialField(unsigned workers) {
+        auto const & positions = _mesh.Positions;
+        auto const & segments = _segments;
+        auto const & bind_positions = _bindPositions;
+        auto const & allowed_joints = _allowedJoints;
+        const std::size_t vcount = positions.size();
+        const std::size_t jcount = bind_positions.size();
+        const float weight_radius = kWeightRadius;
+        //距离不小于weight_radius的骨骼权重为0 用网格只检查顶点附近的骨骼 候选按骨骼序号升序 累加顺序与逐个遍历相同
+        std::vector<std::uint32_t> all_segments(segments.size());
+        for (std::size_t s = 0; s < segments.size(); s++)
+            all_segments[s] = static_cast<std::uint32_t>(s);
+        CapsuleGrid segment_grid;
+        if (weight_radius > 0.0f) {
+            std::vector<Capsule> capsules(segments.size(), Capsule { glm::vec3(0.0f), glm::vec3(0.0f), -1.0f });
+            for (std::size_t s = 0; s < segments.size(); s++) {
+                auto const & seg = segments[s];
+                if (seg.first < jcount && seg.second < jcount)
+                    capsules[s] = { bind_positions[seg.first], bind_positions[seg.second], weight_radius };
+            }
+            segment_grid.Build(positions, capsules);
+        }
+        //初始化权重分布  后续再做热扩散 top-k 归一化
+        _initialField = GatherColumns(vcount, jcount, workers, [&](std::size_t begin, std::size_t end, auto && push) {
+            std::vector<float> joint_weights(jcount, 0.0f);
+            std::vector<std::size_t> touched;
+            for (std::size_t v = begin; v < end; v++) {
+                std::vector<unsigned char> const * allowed = nullptr;
+                if (!allowed_joints.empty() && v < _compId.size()) {
+                    int cid = _compId[v];
+                    if (cid >= 0 && static_cast<std::size_t>(cid) < allowed_joints.size())
+                        allowed = &allowed_joints[static_cast<std::size_t>(cid)];
+                }
+                auto candidates = weight_radius > 0.0f ? segment_grid.Query(positions[v]) : std::span<const std::uint32_t>(all_segments);
+                for (std::uint32_t s_idx : candidates) {
+                    auto const & seg = segments[s_idx];
+                    if (seg.first >= jcount || seg.second >= jcount)
+                        continue;
+                    if (allowed && !(*allowed)[seg.first] && !(*allowed)[seg.second])
+                        continue;
+                    float t = 0.0f;
+                    float dist = DistanceToSegment(positions[v], bind_positions[seg.first], bind_positions[seg.second], t);
+                    //对于骨骼 计算距离 生成权重
+                    float w = 0.0f;
+                    if (weight_radius > 0.0f) {
+                        float s = std::max(0.0f, 1.0f - (dist / weight_radius));
+                        w = std::pow(s, std::max(0.0f, kFalloffPower));
+                    } else {
+                        w = 1.0f / (dist + 1e-6f);
+                    }
+                    if (w <= 0.0f)
+                        continue;
+                    float w_parent = (1.0f - t) * w;
+                    float w_child = t * w;
+                    if (!allowed || (*allowed)[seg.first]) {
+                        if (joint_weights[seg.first] == 0.0f) touched.push_back(seg.first);
+                        joint_weights[seg.first] += w_parent;
+                    }
+                    if (!allowed || (*allowed)[seg.second]) {
+                        if (joint_weights[seg.second] == 0.0f) touched.push_back(seg.second);
+                        joint_weights[seg.second] += w_child;
+                    }
+                }
+
+                for (std::size_t j : touched) {
+                    if (joint_weights[j] != 0.0f)
+                        push(j, v, joint_weights[j]);  //写入weight field
+                    joint_weights[j] = 0.0f;
+                }
+                touched.clear();
+            }
+        });
+    }
+
+    void SkinningBinder::RunAnchors(Options const & options, unsigned workers) {
+        auto const & positions = _mesh.Positions;
+        auto const & bind_positions = _bindPositions;
+        const std::size_t vcount = positions.size();
+        const std::size_t jcount = bind_positions.size();
+        float anchor_radius = std::max(0.0f, options.heatAnchorRadius);
+        _anchored.assign(jcount, {});
+        _pinned.assign(vcount, 0);
+        if (anchor_radius > 0.0f) {  //锚定特殊点
+            float r2 = anchor_radius * anchor_radius;
+            std::vector<Capsule> spheres(jcount);
+            for (std::size_t j = 0; j < jcount; j++)
+                spheres[j] = { bind_positions[j], bind_positions[j], anchor_radius };
+            CapsuleGrid joint_grid;
+            joint_grid.Build(positions, spheres);
+            auto anchor_columns = GatherColumns(vcount, jcount, workers, [&](std::size_t begin, std::size_t end, auto && push) {
+                for (std::size_t v = begin; v < end; v++) {
+                    for (std::uint32_t j : joint_grid.Query(positions[v])) {
+                        glm::vec3 diff = positions[v] - bind_positions[j];
+                        if (glm::dot(diff, diff) <= r2) {
+                            push(j, v, 1.0f);
+                            _pinned[v] = 1;
+                        }
+                    }
+                }
+            });
+            for (std::size_t j = 0; j < jcount; j++)
+                _anchored[j] = std::move(anchor_columns[j].vertices);
+        }
+    }
+
+    void SkinningBinder::RunFactorization(Options const & options) {
+        //隐式步长取显式迭代的总扩散量 所有关节共用同一分解 锚定点取所有关节的并集
+        float lambda = std::clamp(options.heatLambda, 0.0f, 1.0f);
+        int iterations = std::max(1, options.heatIterations);
+        //分解失败(如矩阵非正定)时求解器保持未就绪 扩散阶段据此退回Jacobi
+        _factorized = _solver.Factorize(_neighbors, _pinned, lambda * static_cast<float>(iterations));
+    }
+
+    //热扩散权重迭代 小于min_weight的值不会被top-k选中 扩散结束后直接舍去
+    bool SkinningBinder::RunDiffusion(Options const & options, unsigned workers, CancelCheck const & cancelled) {
+        float lambda = std::clamp(options.heatLambda, 0.0f, 1.0f);
+        int iterations = std::max(1, options.heatIterations);
+        _sparseFallback = false;
+        if (options.heatIterations <= 0)
+            return DiffuseJacobi(_neighbors, {}, 0.0f, 0, _initialField, _weightField, kMinWeight, workers, cancelled);
+        if (options.diffusion == DiffusionMethod::Jacobi)
+            return DiffuseJacobi(_neighbors, _anchored, lambda, iterations, _initialField, _weightField, kMinWeight, workers, cancelled);
+        if (_factorized && _solver.Ready())
+            return _solver.Solve(_initialField, _weightField, kMinWeight, workers, cancelled);
+        //分解失败时用同样的锚定点与参数做显式迭代 不直接使用未扩散的初值
+        _sparseFallback = true;
+        return DiffuseJacobi(_neighbors, _anchored, lambda, iterations, _initialField, _weightField, kMinWeight, workers, cancelled);
+    }
+
+    void SkinningBinder::RunTopK(unsigned workers) {
+        auto const & positions = _mesh.Positions;
+        auto const & bind_positions = _bindPositions;
+        auto const & allowed_joints = _allowedJoints;
+        const std::size_t vcount = positions.size();
+        const std::size_t jcount = bind_positions.size();
+        int max_influences = kMaxInfluence;
+        float min_weight = kMinWeight;
+        _weights.resize(vcount);
+
+        //转置为逐顶点列表 关节序号升序 与逐关节遍历的比较顺序一致
+        std::vector<std::size_t> vertex_offsets(vcount + 1, 0);
+        for (auto const & column : _weightField)
+            for (std::uint32_t v : column.vertices) vertex_offsets[v + 1]++;
+        for (std::size_t v = 0; v < vcount; v++) vertex_offsets[v + 1] += vertex_offsets[v];
+        std::vector<std::pair<int, float>> vertex_weights(vertex_offsets[vcount]);
+        {
+            std::vector<std::size_t> cursor(vertex_offsets.begin(), vertex_offsets.end() - 1);
+            for (std::size_t j = 0; j < _weightField.size(); j++) {
+                auto const & column = _weightField[j];
+                for (std::size_t k = 0; k < column.vertices.size(); k++)
+                    vertex_weights[cursor[column.vertices[k]]++] = { static_cast<int>(j), column.values[k] };
+            }
+        }
+
+        //选取top-k并归一化
+        ParallelFor(vcount, 256, workers, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t v = begin; v < end; v++) {
+                std::vector<unsigned char> const * allowed = nullptr;
+                if (!allowed_joints.empty() && v < _compId.size()) {
+                    int cid = _compId[v];
+                    if (cid >= 0 && static_cast<std::size_t>(cid) < allowed_joints.size())
+                        allowed = &allowed_joints[static_cast<std::size_t>(cid)];
+                }
+                std::array<float, kMaxInfluence> best_w;
+                std::array<int, kMaxInfluence> best_idx;
+                best_w.fill(0.0f);
+                best_idx.fill(-1);
+                //对每个joint 选择top-k
+                for (std::size_t e = vertex_offsets[v]; e < vertex_offsets[v + 1]; e++) {
+                    auto const [j, w] = vertex_weights[e];
+                    if (allowed && !(*allowed)[static_cast<std::size_t>(j)])
+                        continue;
+                    if (w < min_weight)
+                        continue;
+                    if (w <= 0.0f)
+                        continue;
+                    for (int k = 0; k < kMaxInfluence; k++) {
+                        if (w > best_w[k]) {
+                            for (int s = kMaxInfluence - 1; s > k; s--) {
+                                best_w[s] = best_w[s - 1];
+                                best_idx[s] = best_idx[s - 1];
+                            }
+                            best_w[k] = w;
+                            best_idx[k] = j;
+                            break;
+                        }
+                    }
+                }
+
+                Influence inf;
+                inf.joints = best_idx;
+                inf.weights.fill(0.0f);
+
+                float sum = 0.0f;
+                for (int k = 0; k < max_influences; k++) {
+                    if (best_idx[k] < 0) continue;
+                    inf.weights[k] = best_w[k];
+                    sum += best_w[k];
+                }
+                if (sum > 0.0f) {
+                    for (int k = 0; k < max_influences; k++) {
+                        inf.weights[k] /= sum;
+                    }
+                } else {
+                    float best_dist = std::numeric_limits<float>::max();
+                    int best_joint = -1;
+                    for (std::size_t j = 0; j < jcount; j++) {
+                        if (allowed && !(*allowed)[j])
+                            continue;
+                        glm::vec3 diff = positions[v] - bind_positions[j];
+                        float dist = glm::dot(diff, diff);
+                        if (dist < best_dist) {
+                            best_dist = dist;
+                            best_joint = static_cast<int>(j);
+                        }
+                    }
+                    if (best_joint >= 0) {
+                        inf.joints.fill(-1);
+                        inf.weights.fill(0.0f);
+                        inf.joints[0] = best_joint;
+                        inf.weights[0] = 1.0f;
+                    }
+                }
+
+                _weights[v] = inf;
+            }
+        });
+    }
+}
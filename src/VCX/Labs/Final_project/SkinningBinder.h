@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Labs/Final_project/HeatDiffusion.h"
+#include "Labs/Final_project/Skinning.h"
+
+namespace VCX::Labs::Final::Skinning {
+    //绑定流程的各阶段 按依赖顺序排列
+    enum class BindStage {
+        Topology,        //顶点邻接表 只依赖三角形索引
+        Components,      //连通分量及其中心 顶点位置变化时从这里开始重算
+        Skeleton,        //关节位置 绑定逆矩阵 骨骼段
+        BoneAssignment,  //每个连通分量允许的关节 componentMaxJoints
+        InitialField,    //按到骨骼距离衰减的初始权重
+        Anchors,         //关节附近的锚定顶点 heatAnchorRadius
+        Factorization,   //稀疏扩散的矩阵分解 lambda * iterations
+        Diffusion,       //热扩散后的权重场 diffusion/heatLambda/heatIterations
+        TopK,            //每顶点选取top-k并归一化
+        Count,
+    };
+
+    char const * BindStageName(BindStage stage);
+
+    //分阶段缓存的绑定流程: 输入网格/骨骼与Options的变化只使受影响的阶段及其下游失效
+    //例如只调整heatLambda时 Jacobi只重跑扩散与top-k Sparse另需重新分解
+    class SkinningBinder {
+    public:
+        //内容与上次相同时不会使缓存失效 只用到Positions与Indices
+        void SetMesh(Engine::SurfaceMesh const & bindMesh);
+        //bindPose需已调用 Skeleton::UpdateGlobal()
+        void SetSkeleton(Skeleton const & bindPose, float skeletonScale);
+        void Clear();
+
+        //每个需要执行的阶段开始前调用 返回false时中止Build并返回false 已完成的阶段保持有效
+        using StageCallback = std::function<bool(BindStage)>;
+
+        //依次执行失效的阶段 结果与BuildSkinningData一致 workerCount不影响缓存
+        //cancelled在扩散阶段内逐关节/逐列块查询 返回true时中止Build并返回false 该阶段保持失效
+        bool Build(
+            Options const &          options,
+            std::vector<Influence> & weights,
+            std::vector<glm::mat4> & invBind,
+            StageCallback const &    onStage   = {},
+            CancelCheck const &      cancelled = {});
+
+        //最近一次Build实际执行的阶段
+        bool Executed(BindStage stage) const { return (_executed >> static_cast<unsigned>(stage)) & 1u; }
+        //当前权重场请求了Sparse扩散但分解失败 实际由Jacobi迭代得到
+        bool SparseFallback() const { return _sparseFallback; }
+
+    private:
+        void Invalidate(BindStage stage);
+        bool Valid(BindStage stage) const { return (_valid >> static_cast<unsigned>(stage)) & 1u; }
+
+        void RunTopology();
+        void RunComponents();
+        void RunSkeleton();
+        void RunBoneAssignment(Options const & options);
+        void RunInitialField(unsigned workers);
+        void RunAnchors(Options const & options, unsigned workers);
+        void RunFactorization(Options const & options);
+        bool RunDiffusion(Options const & options, unsigned workers, CancelCheck const & cancelled);
+        void RunTopK(unsigned workers);
+
+        std::uint32_t _valid { 0 };
+        std::uint32_t _executed { 0 };
+        Options       _options;        //最近一次Build使用的参数
+        bool          _hasOptions { false };
+        bool          _factorized { false };      //最近一次分解是否成功
+        bool          _sparseFallback { false };
+
+        Engine::SurfaceMesh _mesh;     //只保存Positions与Indices
+        std::vector<glm::vec3> _jointPositions;  //未乘尺度的关节全局变换
+        std::vector<glm::quat> _jointRotations;
+        std::vector<std::pair<std::size_t, std::size_t>> _segments;
+        float _skeletonScale { 0.0f };
+
+        std::vector<std::vector<int>>           _neighbors;
+        std::vector<int>                        _compId;
+        std::vector<glm::vec3>                  _compCenters;
+        std::vector<glm::vec3>                  _bindPositions;
+        std::vector<glm::mat4>                  _invBind;
+        std::vector<std::vector<unsigned char>> _allowedJoints;
+        std::vector<WeightColumn>               _initialField;
+        std::vector<std::vector<std::uint32_t>> _anchored;   //每个关节锚定的顶点
+        std::vector<unsigned char>              _pinned;     //所有关节锚定点的并集
+        HeatDiffusionSolver                     _solver;
+        std::vector<WeightColumn>               _weightField;
+        std::vector<Influence>                  _weights;
+    };
+}
@@ -0,0 +1,125 @@
+#include "Labs/Final_project/SkinningJob.h"
+#include "Labs/Final_project/WeightCache.h"
+
+#include <utility>
+
+namespace VCX::Labs::Final::Skinning {
+    SkinningJob::SkinningJob() :
+        _thread([this] { WorkerLoop(); }) {
+    }
+
+    SkinningJob::~SkinningJob() {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+            _generation++;
+        }
+        _wake.notify_all();
+        _thread.join();
+    }
+
+    void SkinningJob::Start(Engine::SurfaceMesh const & bindMesh, Skeleton const & bindPose, float skeletonScale, Options const & options) {
+        {
+            std::lock_guard lock(_mutex);
+            _request.mesh.Positions = bindMesh.Positions;
+            _request.mesh.Indices   = bindMesh.Indices;
+            _request.pose           = bindPose;
+            _request.scale          = skeletonScale;
+            _request.options        = options;
+            _request.cacheDirectory = _cacheDirectory;
+            _pending = true;
+            _hasResult = false;  //未取走的旧结果已被取代
+            _busy = true;
+            _generation++;
+        }
+        _wake.notify_all();
+    }
+
+    void SkinningJob::Cancel() {
+        std::lock_guard lock(_mutex);
+        _pending = false;
+        _hasResult = false;
+        _generation++;
+        //工作线程尚未取走请求时不会再回到循环开头 需在此清除忙碌状态
+        if (! _running) _busy = false;
+    }
+
+    void SkinningJob::SetCacheDirectory(std::filesystem::path directory) {
+        std::lock_guard lock(_mutex);
+        _cacheDirectory = std::move(directory);
+    }
+
+    bool SkinningJob::TakeResult(std::vector<Influence> & weights, std::vector<glm::mat4> & invBind) {
+        std::lock_guard lock(_mutex);
+        if (! _hasResult) return false;
+        _hasResult = false;
+        weights = std::move(_weights);
+        invBind = std::move(_invBind);
+        return true;
+    }
+
+    void SkinningJob::WorkerLoop() {
+        ThreadPool::Scope scope(_pool);
+        Request request;
+        std::vector<Influence> weights;
+        std::vector<glm::mat4> invBind;
+        for (;;) {
+            std::uint64_t generation;
+            {
+                std::unique_lock lock(_mutex);
+                _running = false;
+                if (! _pending) _busy = false;
+                _wake.wait(lock, [this] { return _stop || _pending; });
+                if (_stop) return;
+                std::swap(request, _request);
+                _pending = false;
+                _running = true;
+                generation = _generation.load();
+            }
+
+            //命中磁盘缓存时跳过全部阶段 binder的阶段缓存保持不变
+            _stage = 0;
+            bool const    use_cache = ! request.cacheDirectory.empty();
+            std::uint64_t key       = 0;
+            bool          cached    = false;
+            if (use_cache) {
+                key    = WeightCacheKey(request.mesh, request.pose, request.scale, request.options);
+                cached = LoadWeightCache(request.cacheDirectory, key, request.mesh.Positions.size(), weights, invBind);
+            }
+
+            //请求被取代或取消后 在下一个阶段开始前或扩散阶段的下一个关节/列块前中止 已完成的阶段留在缓存中供下次复用
+            bool ok = cached;
+            if (! cached) {
+                _binder.SetMesh(request.mesh);
+                _binder.SetSkeleton(request.pose, request.scale);
+                ok = _binder.Build(
+                    request.options, weights, invBind,
+                    [&](BindStage stage) {
+                        _stage = static_cast<int>(stage);
+                        return _generation.load() == generation;
+                    },
+                    [&] { return _generation.load() != generation; });
+                //写入失败只影响下次启动 不影响本次结果
+                if (ok && use_cache && _generation.load() == generation)
+                    SaveWeightCache(request.cacheDirectory, key, weights, invBind);
+            }
+
+            std::lock_guard lock(_mutex);
+            if (_generation.load() != generation) continue;
+            if (! ok) {
+                weights.clear();
+                invBind.clear();
+            }
+            _weights = std::move(weights);
+            _invBind = std::move(invBind);
+            std::uint32_t executed = 0;
+            for (int s = 0; ! cached && s < static_cast<int>(BindStage::Count); s++)
+                if (_binder.Executed(static_cast<BindStage>(s))) executed |= 1u << s;
+            _executed = executed;
+            _fromCache = cached;
+            _sparseFallback = ! cached && ok && _binder.SparseFallback();
+            _hasResult = true;
+            _stage = static_cast<int>(BindStage::Count);
+        }
+    }
+}
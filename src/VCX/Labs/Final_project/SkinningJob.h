@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Labs/Final_project/Parallel.h"
+#include "Labs/Final_project/SkinningBinder.h"
+
+namespace VCX::Labs::Final::Skinning {
+    //后台绑定任务: 常驻一个工作线程 持有分阶段缓存的SkinningBinder
+    //Start只登记请求不阻塞调用线程 新请求到来时正在执行的请求在下一个阶段开始前中止 扩散阶段内逐关节/逐列块检查
+    //结果完成后由TakeResult取走 在此之前调用方继续使用上一份有效权重
+    //绑定使用自己的线程池 不与每帧蒙皮共用ThreadPool::Shared() 两者同时进行时都保持并行
+    class SkinningJob {
+    public:
+        SkinningJob();
+        ~SkinningJob();
+
+        SkinningJob(SkinningJob const &) = delete;
+        SkinningJob & operator=(SkinningJob const &) = delete;
+
+        //bindPose需已调用 Skeleton::UpdateGlobal() 参数被复制 调用后可立即修改
+        void Start(Engine::SurfaceMesh const & bindMesh, Skeleton const & bindPose, float skeletonScale, Options const & options);
+        //丢弃尚未开始的请求并中止正在执行的请求
+        void Cancel();
+
+        //磁盘权重缓存目录 为空时不读写缓存 对之后的Start生效
+        void SetCacheDirectory(std::filesystem::path directory);
+
+        bool Busy() const { return _busy.load(); }
+        //正在执行的阶段与整体进度[0, 1]
+        BindStage Stage() const { return static_cast<BindStage>(_stage.load()); }
+        float     Progress() const { return static_cast<float>(_stage.load()) / static_cast<float>(BindStage::Count); }
+
+        //有新完成的结果时移交并返回true 绑定失败时weights为空
+        bool TakeResult(std::vector<Influence> & weights, std::vector<glm::mat4> & invBind);
+        //最近一次完成的绑定实际执行的阶段
+        bool Executed(BindStage stage) const { return (_executed.load() >> static_cast<unsigned>(stage)) & 1u; }
+        //最近一次完成的结果直接读自磁盘缓存
+        bool FromCache() const { return _fromCache.load(); }
+        //最近一次完成的结果请求了Sparse扩散但分解失败 退回了Jacobi迭代
+        bool SparseFallback() const { return _sparseFallback.load(); }
+
+    private:
+        struct Request {
+            Engine::SurfaceMesh mesh;
+            Skeleton            pose;
+            float               scale { 0.0f };
+            Options             options;
+            std::filesystem::path cacheDirectory;
+        };
+
+        void WorkerLoop();
+
+        ThreadPool                 _pool { ResolveWorkerCount(0) - 1 };
+        SkinningBinder             _binder;  //只在工作线程中访问
+        mutable std::mutex         _mutex;
+        std::condition_variable    _wake;
+        Request                    _request;
+        std::filesystem::path      _cacheDirectory;
+        bool                       _pending { false };
+        bool                       _stop { false };
+        bool                       _running { false };  //工作线程正在执行请求 由_mutex保护
+        std::atomic<std::uint64_t> _generation { 0 };  //每次Start/Cancel递增 执行中的请求据此判断是否已被取代
+        std::atomic_bool           _busy { false };
+        std::atomic<int>           _stage { 0 };
+        std::atomic<std::uint32_t> _executed { 0 };
+        std::atomic_bool           _fromCache { false };
+        std::atomic_bool           _sparseFallback { false };
+        bool                       _hasResult { false };
+        std::vector<Influence>     _weights;
+        std::vector<glm::mat4>     _invBind;
+        std::thread                _thread;  //最后构造 启动时其余成员均已初始化
+    };
+}
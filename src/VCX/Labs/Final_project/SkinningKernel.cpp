@@ -0,0 +1,566 @@
+#include "Labs/Final_project/SkinningKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Labs/Final_project/Parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VCX_SKINNING_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC无需额外编译选项即可使用AVX2内建函数 GCC/Clang需要为单个函数打开目标特性
+#if defined(VCX_SKINNING_X86) && ! defined(_MSC_VER)
+#define VCX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define VCX_TARGET_AVX2
+#endif
+
+namespace VCX::Labs::Final::Skinning {
+namespace {
+    struct BatchView {
+        float const *        x;
+        float const *        y;
+        float const *        z;
+        std::uint16_t const * joints;
+        std::uint16_t const * weights;
+        float const *        palette;
+        std::uint8_t const * influences;
+        std::size_t          padded;
+    };
+
+    constexpr std::size_t c_Batch = LinearBlendKernel::c_BatchSize;
+    constexpr std::size_t c_BatchGrain = 128;  //每个线程至少处理的批数
+    //权重以整数累加 每批结果最后统一乘以此系数
+    constexpr float c_WeightScale = 1.0f / static_cast<float>(PackedInfluence16::c_WeightMax);
+
+    //SoA结果写回AoS输出 末尾批次只写有效顶点
+    void StoreBatch(float const * sx, float const * sy, float const * sz, std::size_t first, std::size_t count, glm::vec3 * out) {
+        std::size_t n = std::min(c_Batch, count - first);
+        for (std::size_t j = 0; j < n; j++) out[first + j] = glm::vec3(sx[j], sy[j], sz[j]);
+    }
+
+    void SkinScalar(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        for (std::size_t b = begin; b < end; b++) {
+            float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+            for (std::size_t j = 0; j < c_Batch; j++) {
+                std::size_t v = b * c_Batch + j;
+                float x = view.x[v], y = view.y[v], z = view.z[v];
+                float ax = 0.0f, ay = 0.0f, az = 0.0f;
+                for (std::size_t k = 0; k < view.influences[b]; k++) {
+                    float w = view.weights[k * view.padded + v];
+                    float const * m = view.palette + view.joints[k * view.padded + v] * 12;
+                    ax += w * (m[0] * x + m[1] * y + m[2] * z + m[3]);
+                    ay += w * (m[4] * x + m[5] * y + m[6] * z + m[7]);
+                    az += w * (m[8] * x + m[9] * y + m[10] * z + m[11]);
+                }
+                sx[j] = ax * c_WeightScale;
+                sy[j] = ay * c_WeightScale;
+                sz[j] = az * c_WeightScale;
+            }
+            StoreBatch(sx, sy, sz, b * c_Batch, count, out);
+        }
+    }
+
+    //混合后的对偶四元数先按旋转部分的模归一化 再变换顶点: p' = R(p) + t
+    //R(p) = p + 2 * r.xyz x (r.xyz x p + r.w * p)   t = 2 * (r.w * d.xyz - d.w * r.xyz + r.xyz x d.xyz)
+    //没有任何影响的顶点旋转部分为0 模平方不超过该值时输出原点 与线性混合的结果一致
+    constexpr float c_MinDqNorm2 = 1e-30f;
+
+    void SkinDualQuatScalar(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        for (std::size_t b = begin; b < end; b++) {
+            float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+            for (std::size_t j = 0; j < c_Batch; j++) {
+                std::size_t v = b * c_Batch + j;
+                float const * pivot = view.palette + view.joints[v] * 8;
+                float q[8] {};
+                for (std::size_t k = 0; k < view.influences[b]; k++) {
+                    float w = view.weights[k * view.padded + v];
+                    float const * m = view.palette + view.joints[k * view.padded + v] * 8;
+                    if (m[0] * pivot[0] + m[1] * pivot[1] + m[2] * pivot[2] + m[3] * pivot[3] < 0.0f) w = -w;
+                    for (int i = 0; i < 8; i++) q[i] += w * m[i];
+                }
+                float norm2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+                if (! (norm2 > c_MinDqNorm2)) {
+                    sx[j] = sy[j] = sz[j] = 0.0f;
+                    continue;
+                }
+                float inv = 1.0f / std::sqrt(norm2);
+                float rx = q[0] * inv, ry = q[1] * inv, rz = q[2] * inv, rw = q[3] * inv;
+                float dx = q[4] * inv, dy = q[5] * inv, dz = q[6] * inv, dw = q[7] * inv;
+                float x = view.x[v], y = view.y[v], z = view.z[v];
+                float cx = ry * z - rz * y + rw * x;
+                float cy = rz * x - rx * z + rw * y;
+                float cz = rx * y - ry * x + rw * z;
+                sx[j] = x + 2.0f * (ry * cz - rz * cy + rw * dx - dw * rx + ry * dz - rz * dy);
+                sy[j] = y + 2.0f * (rz * cx - rx * cz + rw * dy - dw * ry + rz * dx - rx * dz);
+                sz[j] = z + 2.0f * (rx * cy - ry * cx + rw * dz - dw * rz + rx * dy - ry * dx);
+            }
+            StoreBatch(sx, sy, sz, b * c_Batch, count, out);
+        }
+    }
+
+#ifdef VCX_SKINNING_X86
+    void SkinSSE2(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        alignas(16) float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+        for (std::size_t b = begin; b < end; b++) {
+            for (std::size_t half = 0; half < c_Batch; half += 4) {
+                std::size_t v = b * c_Batch + half;
+                __m128 x = _mm_loadu_ps(view.x + v);
+                __m128 y = _mm_loadu_ps(view.y + v);
+                __m128 z = _mm_loadu_ps(view.z + v);
+                __m128 ax = _mm_setzero_ps(), ay = _mm_setzero_ps(), az = _mm_setzero_ps();
+                for (std::size_t k = 0; k < view.influences[b]; k++) {
+                    __m128i q = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(view.weights + k * view.padded + v));
+                    __m128  w = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q, _mm_setzero_si128()));
+                    std::uint16_t const * o = view.joints + k * view.padded + v;
+                    float const * m0 = view.palette + o[0] * 12;
+                    float const * m1 = view.palette + o[1] * 12;
+                    float const * m2 = view.palette + o[2] * 12;
+                    float const * m3 = view.palette + o[3] * 12;
+                    auto row = [&](int r) {
+                        __m128 c0 = _mm_setr_ps(m0[r * 4 + 0], m1[r * 4 + 0], m2[r * 4 + 0], m3[r * 4 + 0]);
+                        __m128 c1 = _mm_setr_ps(m0[r * 4 + 1], m1[r * 4 + 1], m2[r * 4 + 1], m3[r * 4 + 1]);
+                        __m128 c2 = _mm_setr_ps(m0[r * 4 + 2], m1[r * 4 + 2], m2[r * 4 + 2], m3[r * 4 + 2]);
+                        __m128 c3 = _mm_setr_ps(m0[r * 4 + 3], m1[r * 4 + 3], m2[r * 4 + 3], m3[r * 4 + 3]);
+                        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), _mm_add_ps(_mm_mul_ps(c2, z), c3));
+                    };
+                    ax = _mm_add_ps(ax, _mm_mul_ps(w, row(0)));
+                    ay = _mm_add_ps(ay, _mm_mul_ps(w, row(1)));
+                    az = _mm_add_ps(az, _mm_mul_ps(w, row(2)));
+                }
+                __m128 scale = _mm_set1_ps(c_WeightScale);
+                _mm_store_ps(sx + half, _mm_mul_ps(ax, scale));
+                _mm_store_ps(sy + half, _mm_mul_ps(ay, scale));
+                _mm_store_ps(sz + half, _mm_mul_ps(az, scale));
+            }
+            StoreBatch(sx, sy, sz, b * c_Batch, count, out);
+        }
+    }
+
+    //8个顶点的关节序号扩展为调色板中的float偏移
+    VCX_TARGET_AVX2 inline void JointOffsetsAVX2(std::uint16_t const * joints, int stride, std::int32_t (&o)[c_Batch]) {
+        __m128i j = _mm_loadu_si128(reinterpret_cast<__m128i const *>(joints));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(o), _mm256_mullo_epi32(_mm256_cvtepu16_epi32(j), _mm256_set1_epi32(stride)));
+    }
+
+    //取8个顶点各自关节的调色板第r行(每行4个float) 转置成4列后与顶点做点乘
+    //逐行加载再转置比_mm256_i32gather_ps快 后者在部分处理器上是微码实现
+    VCX_TARGET_AVX2 inline __m256 TransformRowAVX2(float const * palette, std::int32_t const * o, int r, __m256 x, __m256 y, __m256 z) {
+        __m128 a0 = _mm_loadu_ps(palette + o[0] + r * 4);
+        __m128 a1 = _mm_loadu_ps(palette + o[1] + r * 4);
+        __m128 a2 = _mm_loadu_ps(palette + o[2] + r * 4);
+        __m128 a3 = _mm_loadu_ps(palette + o[3] + r * 4);
+        __m128 a4 = _mm_loadu_ps(palette + o[4] + r * 4);
+        __m128 a5 = _mm_loadu_ps(palette + o[5] + r * 4);
+        __m128 a6 = _mm_loadu_ps(palette + o[6] + r * 4);
+        __m128 a7 = _mm_loadu_ps(palette + o[7] + r * 4);
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(a4, a5, a6, a7);
+        __m256 c0 = _mm256_set_m128(a4, a0);
+        __m256 c1 = _mm256_set_m128(a5, a1);
+        __m256 c2 = _mm256_set_m128(a6, a2);
+        __m256 c3 = _mm256_set_m128(a7, a3);
+        return _mm256_fmadd_ps(c0, x, _mm256_fmadd_ps(c1, y, _mm256_fmadd_ps(c2, z, c3)));
+    }
+
+    VCX_TARGET_AVX2 void SkinAVX2(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        alignas(32) float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+        for (std::size_t b = begin; b < end; b++) {
+            std::size_t v = b * c_Batch;
+            __m256 x = _mm256_loadu_ps(view.x + v);
+            __m256 y = _mm256_loadu_ps(view.y + v);
+            __m256 z = _mm256_loadu_ps(view.z + v);
+            __m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps();
+            for (std::size_t k = 0; k < view.influences[b]; k++) {
+                __m128i q = _mm_loadu_si128(reinterpret_cast<__m128i const *>(view.weights + k * view.padded + v));
+                __m256  w = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(q));
+                alignas(32) std::int32_t o[c_Batch];
+                JointOffsetsAVX2(view.joints + k * view.padded + v, 12, o);
+                ax = _mm256_fmadd_ps(w, TransformRowAVX2(view.palette, o, 0, x, y, z), ax);
+                ay = _mm256_fmadd_ps(w, TransformRowAVX2(view.palette, o, 1, x, y, z), ay);
+                az = _mm256_fmadd_ps(w, TransformRowAVX2(view.palette, o, 2, x, y, z), az);
+            }
+            __m256 scale = _mm256_set1_ps(c_WeightScale);
+            _mm256_store_ps(sx, _mm256_mul_ps(ax, scale));
+            _mm256_store_ps(sy, _mm256_mul_ps(ay, scale));
+            _mm256_store_ps(sz, _mm256_mul_ps(az, scale));
+            StoreBatch(sx, sy, sz, v, count, out);
+        }
+    }
+
+    //取4个顶点各自关节的四元数(调色板偏移part处的4个float) 转置为xyzw四个分量
+    inline void GatherQuatSSE2(float const * palette, std::uint16_t const * o, int part, __m128 (&q)[4]) {
+        q[0] = _mm_loadu_ps(palette + o[0] * 8 + part);
+        q[1] = _mm_loadu_ps(palette + o[1] * 8 + part);
+        q[2] = _mm_loadu_ps(palette + o[2] * 8 + part);
+        q[3] = _mm_loadu_ps(palette + o[3] * 8 + part);
+        _MM_TRANSPOSE4_PS(q[0], q[1], q[2], q[3]);
+    }
+
+    inline __m128 Dot4SSE2(__m128 const (&a)[4], __m128 const (&b)[4]) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])), _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+    }
+
+    void SkinDualQuatSSE2(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        alignas(16) float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+        __m128 const sign = _mm_set1_ps(-0.0f);
+        __m128 const two = _mm_set1_ps(2.0f);
+        for (std::size_t b = begin; b < end; b++) {
+            for (std::size_t half = 0; half < c_Batch; half += 4) {
+                std::size_t v = b * c_Batch + half;
+                __m128 pivot[4] {}, r[4] {}, d[4] {};
+                for (std::size_t k = 0; k < view.influences[b]; k++) {
+                    __m128i iw = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(view.weights + k * view.padded + v));
+                    __m128  w = _mm_cvtepi32_ps(_mm_unpacklo_epi16(iw, _mm_setzero_si128()));
+                    std::uint16_t const * o = view.joints + k * view.padded + v;
+                    __m128 qr[4], qd[4];
+                    GatherQuatSSE2(view.palette, o, 0, qr);
+                    GatherQuatSSE2(view.palette, o, 4, qd);
+                    //第一个影响的权重最大 作为基准 与之点积为负时权重取反 无分支
+                    if (k == 0) std::copy(qr, qr + 4, pivot);
+                    w = _mm_xor_ps(w, _mm_and_ps(Dot4SSE2(qr, pivot), sign));
+                    for (int i = 0; i < 4; i++) {
+                        r[i] = _mm_add_ps(r[i], _mm_mul_ps(w, qr[i]));
+                        d[i] = _mm_add_ps(d[i], _mm_mul_ps(w, qd[i]));
+                    }
+                }
+                __m128 norm2 = Dot4SSE2(r, r);
+                __m128 valid = _mm_cmpgt_ps(norm2, _mm_set1_ps(c_MinDqNorm2));
+                __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(norm2, _mm_set1_ps(c_MinDqNorm2))));
+                for (int i = 0; i < 4; i++) {
+                    r[i] = _mm_mul_ps(r[i], inv);
+                    d[i] = _mm_mul_ps(d[i], inv);
+                }
+                __m128 x = _mm_loadu_ps(view.x + v);
+                __m128 y = _mm_loadu_ps(view.y + v);
+                __m128 z = _mm_loadu_ps(view.z + v);
+                auto cross = [](__m128 a1, __m128 a2, __m128 b1, __m128 b2) { return _mm_sub_ps(_mm_mul_ps(a1, b1), _mm_mul_ps(a2, b2)); };
+                __m128 cx = _mm_add_ps(cross(r[1], r[2], z, y), _mm_mul_ps(r[3], x));
+                __m128 cy = _mm_add_ps(cross(r[2], r[0], x, z), _mm_mul_ps(r[3], y));
+                __m128 cz = _mm_add_ps(cross(r[0], r[1], y, x), _mm_mul_ps(r[3], z));
+                __m128 tx = _mm_add_ps(cross(r[3], d[3], d[0], r[0]), cross(r[1], r[2], d[2], d[1]));
+                __m128 ty = _mm_add_ps(cross(r[3], d[3], d[1], r[1]), cross(r[2], r[0], d[0], d[2]));
+                __m128 tz = _mm_add_ps(cross(r[3], d[3], d[2], r[2]), cross(r[0], r[1], d[1], d[0]));
+                _mm_store_ps(sx + half, _mm_and_ps(valid, _mm_add_ps(x, _mm_mul_ps(two, _mm_add_ps(cross(r[1], r[2], cz, cy), tx)))));
+                _mm_store_ps(sy + half, _mm_and_ps(valid, _mm_add_ps(y, _mm_mul_ps(two, _mm_add_ps(cross(r[2], r[0], cx, cz), ty)))));
+                _mm_store_ps(sz + half, _mm_and_ps(valid, _mm_add_ps(z, _mm_mul_ps(two, _mm_add_ps(cross(r[0], r[1], cy, cx), tz)))));
+            }
+            StoreBatch(sx, sy, sz, b * c_Batch, count, out);
+        }
+    }
+
+    //8个顶点的四元数: 两组4x4转置后拼接
+    VCX_TARGET_AVX2 inline void GatherQuatAVX2(float const * palette, std::int32_t const * o, int part, __m256 (&q)[4]) {
+        __m128 a0 = _mm_loadu_ps(palette + o[0] + part);
+        __m128 a1 = _mm_loadu_ps(palette + o[1] + part);
+        __m128 a2 = _mm_loadu_ps(palette + o[2] + part);
+        __m128 a3 = _mm_loadu_ps(palette + o[3] + part);
+        __m128 a4 = _mm_loadu_ps(palette + o[4] + part);
+        __m128 a5 = _mm_loadu_ps(palette + o[5] + part);
+        __m128 a6 = _mm_loadu_ps(palette + o[6] + part);
+        __m128 a7 = _mm_loadu_ps(palette + o[7] + part);
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(a4, a5, a6, a7);
+        q[0] = _mm256_set_m128(a4, a0);
+        q[1] = _mm256_set_m128(a5, a1);
+        q[2] = _mm256_set_m128(a6, a2);
+        q[3] = _mm256_set_m128(a7, a3);
+    }
+
+    VCX_TARGET_AVX2 inline __m256 Dot4AVX2(__m256 const (&a)[4], __m256 const (&b)[4]) {
+        return _mm256_fmadd_ps(a[0], b[0], _mm256_fmadd_ps(a[1], b[1], _mm256_fmadd_ps(a[2], b[2], _mm256_mul_ps(a[3], b[3]))));
+    }
+
+    //a1 * b1 - a2 * b2
+    VCX_TARGET_AVX2 inline __m256 CrossTermAVX2(__m256 a1, __m256 a2, __m256 b1, __m256 b2) {
+        return _mm256_fmsub_ps(a1, b1, _mm256_mul_ps(a2, b2));
+    }
+
+    VCX_TARGET_AVX2 void SkinDualQuatAVX2(BatchView const & view, std::size_t begin, std::size_t end, std::size_t count, glm::vec3 * out) {
+        alignas(32) float sx[c_Batch], sy[c_Batch], sz[c_Batch];
+        __m256 const sign = _mm256_set1_ps(-0.0f);
+        __m256 const two = _mm256_set1_ps(2.0f);
+        for (std::size_t b = begin; b < end; b++) {
+            std::size_t v = b * c_Batch;
+            __m256 pivot[4] {}, r[4] {}, d[4] {};
+            for (std::size_t k = 0; k < view.influences[b]; k++) {
+                alignas(32) std::int32_t o[c_Batch];
+                __m128i iw = _mm_loadu_si128(reinterpret_cast<__m128i const *>(view.weights + k * view.padded + v));
+                __m256  w = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(iw));
+                JointOffsetsAVX2(view.joints + k * view.padded + v, 8, o);
+                __m256 qr[4], qd[4];
+                GatherQuatAVX2(view.palette, o, 0, qr);
+                GatherQuatAVX2(view.palette, o, 4, qd);
+                if (k == 0) std::copy(qr, qr + 4, pivot);
+                w = _mm256_xor_ps(w, _mm256_and_ps(Dot4AVX2(qr, pivot), sign));
+                for (int i = 0; i < 4; i++) {
+                    r[i] = _mm256_fmadd_ps(w, qr[i], r[i]);
+                    d[i] = _mm256_fmadd_ps(w, qd[i], d[i]);
+                }
+            }
+            __m256 norm2 = Dot4AVX2(r, r);
+            __m256 valid = _mm256_cmp_ps(norm2, _mm256_set1_ps(c_MinDqNorm2), _CMP_GT_OQ);
+            __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(norm2, _mm256_set1_ps(c_MinDqNorm2))));
+            for (int i = 0; i < 4; i++) {
+                r[i] = _mm256_mul_ps(r[i], inv);
+                d[i] = _mm256_mul_ps(d[i], inv);
+            }
+            __m256 x = _mm256_loadu_ps(view.x + v);
+            __m256 y = _mm256_loadu_ps(view.y + v);
+            __m256 z = _mm256_loadu_ps(view.z + v);
+            __m256 cx = _mm256_fmadd_ps(r[3], x, CrossTermAVX2(r[1], r[2], z, y));
+            __m256 cy = _mm256_fmadd_ps(r[3], y, CrossTermAVX2(r[2], r[0], x, z));
+            __m256 cz = _mm256_fmadd_ps(r[3], z, CrossTermAVX2(r[0], r[1], y, x));
+            __m256 tx = _mm256_add_ps(CrossTermAVX2(r[3], d[3], d[0], r[0]), CrossTermAVX2(r[1], r[2], d[2], d[1]));
+            __m256 ty = _mm256_add_ps(CrossTermAVX2(r[3], d[3], d[1], r[1]), CrossTermAVX2(r[2], r[0], d[0], d[2]));
+            __m256 tz = _mm256_add_ps(CrossTermAVX2(r[3], d[3], d[2], r[2]), CrossTermAVX2(r[0], r[1], d[1], d[0]));
+            _mm256_store_ps(sx, _mm256_and_ps(valid, _mm256_fmadd_ps(two, _mm256_add_ps(CrossTermAVX2(r[1], r[2], cz, cy), tx), x)));
+            _mm256_store_ps(sy, _mm256_and_ps(valid, _mm256_fmadd_ps(two, _mm256_add_ps(CrossTermAVX2(r[2], r[0], cx, cz), ty), y)));
+            _mm256_store_ps(sz, _mm256_and_ps(valid, _mm256_fmadd_ps(two, _mm256_add_ps(CrossTermAVX2(r[0], r[1], cy, cx), tz), z)));
+            StoreBatch(sx, sy, sz, v, count, out);
+        }
+    }
+
+    SimdLevel QuerySimdLevel() {
+#ifdef _MSC_VER
+        int info[4] {};
+        __cpuid(info, 0);
+        if (info[0] < 7) return SimdLevel::SSE2;
+        __cpuid(info, 1);
+        bool fma = (info[2] & (1 << 12)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (! (fma && osxsave && avx) || (_xgetbv(0) & 0x6) != 0x6) return SimdLevel::SSE2;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+    }
+#else
+    SimdLevel QuerySimdLevel() {
+        return SimdLevel::Scalar;
+    }
+#endif
+} // namespace
+
+    SimdLevel DetectSimdLevel() {
+        static const SimdLevel level = QuerySimdLevel();
+        return level;
+    }
+
+    char const * SimdLevelName(SimdLevel level) {
+        switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE2: return "SSE2";
+        default: return "Scalar";
+        }
+    }
+
+    void ComputeSkinningMatrices(
+        Skeleton const &           pose,
+        float                      skeletonScale,
+        std::span<const glm::mat4> invBind,
+        std::vector<glm::mat4> &   skinMats) {
+        const std::size_t joint_count = std::min(pose.JointCount(), invBind.size());
+        skinMats.resize(joint_count);
+        for (std::size_t i = 0; i < joint_count; i++) {
+            glm::vec3 pos = pose.global_trans[i] * skeletonScale;
+            glm::mat4 joint_mat = glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(pose.global_rot[i]);
+            skinMats[i] = joint_mat * invBind[i];
+        }
+    }
+
+    void ComputeSkinningDualQuats(
+        Skeleton const &           pose,
+        float                      skeletonScale,
+        std::span<const glm::mat4> invBind,
+        std::vector<DualQuat> &    skinDqs) {
+        const std::size_t joint_count = std::min(pose.JointCount(), invBind.size());
+        skinDqs.resize(joint_count);
+        for (std::size_t i = 0; i < joint_count; i++) {
+            //蒙皮变换 = 关节(R_j, t_j) * 绑定逆(R_b, t_b) = (R_j * R_b, R_j * t_b + t_j)
+            glm::quat bind_rot = glm::quat_cast(glm::mat3(invBind[i]));
+            glm::quat rot = glm::normalize(pose.global_rot[i] * bind_rot);
+            glm::vec3 pos = pose.global_rot[i] * glm::vec3(invBind[i][3]) + pose.global_trans[i] * skeletonScale;
+            skinDqs[i].real = rot;
+            skinDqs[i].dual = glm::quat(0.0f, pos.x, pos.y, pos.z) * rot * 0.5f;
+        }
+    }
+
+    void LinearBlendKernel::Clear() {
+        _count = _padded = _jointLimit = 0;
+        _x.clear();
+        _y.clear();
+        _z.clear();
+        _joints.clear();
+        _weights.clear();
+        _influences.clear();
+        _adjacency.Clear();
+    }
+
+    void LinearBlendKernel::SetLevel(SimdLevel level) {
+        _level = std::min(level, DetectSimdLevel());
+    }
+
+    void LinearBlendKernel::Prepare(std::span<const glm::vec3> positions, std::span<const Influence> weights, std::span<const std::uint32_t> indices) {
+        std::vector<PackedInfluence16> packed;
+        if (! PackInfluences(weights, packed)) {
+            Clear();
+            return;
+        }
+        PreparePacked<PackedInfluence16>(positions, packed, indices);
+    }
+
+    void LinearBlendKernel::Prepare(std::span<const glm::vec3> positions, std::span<const PackedInfluence16> weights, std::span<const std::uint32_t> indices) {
+        PreparePacked(positions, weights, indices);
+    }
+
+    void LinearBlendKernel::Prepare(std::span<const glm::vec3> positions, std::span<const PackedInfluence8> weights, std::span<const std::uint32_t> indices) {
+        PreparePacked(positions, weights, indices);
+    }
+
+    template<typename Packed>
+    void LinearBlendKernel::PreparePacked(std::span<const glm::vec3> positions, std::span<const Packed> weights, std::span<const std::uint32_t> indices) {
+        //权重统一放大到unorm16 两种布局的和都恰为c_WeightMax
+        constexpr std::uint32_t c_Widen = PackedInfluence16::c_WeightMax / Packed::c_WeightMax;
+        static_assert(c_Widen * Packed::c_WeightMax == PackedInfluence16::c_WeightMax);
+
+        Clear();
+        if (positions.empty() || positions.size() != weights.size()) return;
+        _count = positions.size();
+        _padded = (_count + c_BatchSize - 1) / c_BatchSize * c_BatchSize;
+        _x.assign(_padded, 0.0f);
+        _y.assign(_padded, 0.0f);
+        _z.assign(_padded, 0.0f);
+        _joints.assign(4 * _padded, 0);
+        _weights.assign(4 * _padded, 0);
+        _influences.assign(_padded / c_BatchSize, 0);
+        for (std::size_t v = 0; v < _count; v++) {
+            _x[v] = positions[v].x;
+            _y[v] = positions[v].y;
+            _z[v] = positions[v].z;
+            //有效影响已按权重降序排在前面 每批只需处理到批内最多的影响数
+            std::uint32_t used = weights[v].Count();
+            for (std::uint32_t k = 0; k < used; k++) {
+                _joints[k * _padded + v]  = weights[v].joints[k];
+                _weights[k * _padded + v] = static_cast<std::uint16_t>(weights[v].weights[k] * c_Widen);
+                _jointLimit = std::max(_jointLimit, static_cast<std::size_t>(weights[v].joints[k]) + 1);
+            }
+            auto & batch = _influences[v / c_BatchSize];
+            batch = std::max(batch, static_cast<std::uint8_t>(used));
+        }
+        if (! indices.empty()) _adjacency.Build(indices, _count);
+    }
+
+    void LinearBlendKernel::ApplyBatches(std::size_t begin, std::size_t end, std::span<glm::vec3> out) const {
+        BatchView view { _x.data(), _y.data(), _z.data(), _joints.data(), _weights.data(), _palette.data(), _influences.data(), _padded };
+        switch (_level) {
+#ifdef VCX_SKINNING_X86
+        case SimdLevel::AVX2: SkinAVX2(view, begin, end, _count, out.data()); break;
+        case SimdLevel::SSE2: SkinSSE2(view, begin, end, _count, out.data()); break;
+#endif
+        default: SkinScalar(view, begin, end, _count, out.data()); break;
+        }
+    }
+
+    bool LinearBlendKernel::Apply(std::span<const glm::mat4> skinMats, std::span<glm::vec3> out) const {
+        if (! Ready() || out.size() != _count || skinMats.size() < _jointLimit) return false;
+        //glm为列主序 调色板按行存放 便于逐行点乘
+        _palette.resize(std::max<std::size_t>(1, skinMats.size()) * 12, 0.0f);
+        for (std::size_t j = 0; j < skinMats.size(); j++) {
+            float * p = _palette.data() + j * 12;
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 4; c++) p[r * 4 + c] = skinMats[j][c][r];
+        }
+        //各线程写入互不重叠的顶点区间
+        ParallelFor(_padded / c_BatchSize, c_BatchGrain, _workers, [&](std::size_t begin, std::size_t end) {
+            ApplyBatches(begin, end, out);
+        });
+        return true;
+    }
+
+    void LinearBlendKernel::ApplyDualQuatBatches(std::size_t begin, std::size_t end, std::span<glm::vec3> out) const {
+        BatchView view { _x.data(), _y.data(), _z.data(), _joints.data(), _weights.data(), _dqPalette.data(), _influences.data(), _padded };
+        switch (_level) {
+#ifdef VCX_SKINNING_X86
+        case SimdLevel::AVX2: SkinDualQuatAVX2(view, begin, end, _count, out.data()); break;
+        case SimdLevel::SSE2: SkinDualQuatSSE2(view, begin, end, _count, out.data()); break;
+#endif
+        default: SkinDualQuatScalar(view, begin, end, _count, out.data()); break;
+        }
+    }
+
+    bool LinearBlendKernel::ApplyDualQuat(std::span<const DualQuat> skinDqs, std::span<glm::vec3> out) const {
+        if (! Ready() || out.size() != _count || skinDqs.size() < _jointLimit) return false;
+        //权重为未归一化的整数 混合后按旋转部分的模归一化时一并消去
+        _dqPalette.resize(std::max<std::size_t>(1, skinDqs.size()) * 8, 0.0f);
+        for (std::size_t j = 0; j < skinDqs.size(); j++) {
+            float * p = _dqPalette.data() + j * 8;
+            glm::quat const & r = skinDqs[j].real;
+            glm::quat const & d = skinDqs[j].dual;
+            p[0] = r.x, p[1] = r.y, p[2] = r.z, p[3] = r.w;
+            p[4] = d.x, p[5] = d.y, p[6] = d.z, p[7] = d.w;
+        }
+        ParallelFor(_padded / c_BatchSize, c_BatchGrain, _workers, [&](std::size_t begin, std::size_t end) {
+            ApplyDualQuatBatches(begin, end, out);
+        });
+        return true;
+    }
+
+    bool LinearBlendKernel::ComputeNormals(std::span<const glm::vec3> positions, std::span<const std::uint32_t> indices, std::span<glm::vec3> normals) const {
+        if (_adjacency.VertexCount() != positions.size() || _adjacency.FaceCount() != indices.size() / 3 || normals.size() != positions.size()) return false;
+        _adjacency.ComputeNormals(positions, indices, normals, _workers);
+        return true;
+    }
+
+    bool ApplySkinning(
+        Skeleton const &               pose,
+        float                          skeletonScale,
+        LinearBlendKernel const &      kernel,
+        std::span<const glm::mat4>     invBind,
+        std::span<const std::uint32_t> indices,
+        SkinningMethod                 method,
+        SkinningScratch &              scratch,
+        std::span<glm::vec3>           positions,
+        std::span<glm::vec3>           normals) {
+        if (invBind.empty() || pose.JointCount() != invBind.size() || normals.size() != positions.size())
+            return false;
+        if (method == SkinningMethod::DualQuaternion) {
+            ComputeSkinningDualQuats(pose, skeletonScale, invBind, scratch.skinDqs);
+            if (! kernel.ApplyDualQuat(scratch.skinDqs, positions)) return false;
+        } else {
+            ComputeSkinningMatrices(pose, skeletonScale, invBind, scratch.skinMats);
+            if (! kernel.Apply(scratch.skinMats, positions)) return false;
+        }
+        if (! kernel.ComputeNormals(positions, indices, normals))
+            Final::ComputeNormals(positions, indices, normals);
+        return true;
+    }
+
+    bool ApplySkinning(
+        Engine::SurfaceMesh const &    bindMesh,
+        Skeleton const &               pose,
+        float                          skeletonScale,
+        LinearBlendKernel const &      kernel,
+        std::vector<glm::mat4> const & invBind,
+        Engine::SurfaceMesh &          outMesh,
+        SkinningMethod                 method) {
+        if (kernel.VertexCount() != bindMesh.Positions.size()) return false;
+        SkinningScratch scratch;
+        outMesh.Indices   = bindMesh.Indices;
+        outMesh.TexCoords = bindMesh.TexCoords;
+        outMesh.Positions.resize(bindMesh.Positions.size());
+        outMesh.Normals.resize(bindMesh.Positions.size());
+        return ApplySkinning(pose, skeletonScale, kernel, invBind, outMesh.Indices, method, scratch, outMesh.Positions, outMesh.Normals);
+    }
+}
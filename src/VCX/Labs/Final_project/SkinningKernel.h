@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "Labs/Final_project/MeshNormals.h"
+#include "Labs/Final_project/PackedInfluence.h"
+#include "Labs/Final_project/Skinning.h"
+
+namespace VCX::Labs::Final::Skinning {
+    enum class SimdLevel {
+        Scalar,
+        SSE2,
+        AVX2,  //AVX2 + FMA
+    };
+
+    enum class SkinningMethod {
+        Linear,          //线性混合 大角度扭转时体积塌缩
+        DualQuaternion,  //对偶四元数混合 保持刚体性 要求蒙皮变换不含缩放
+    };
+
+    //单位对偶四元数 real为旋转 dual = 0.5 * (0, t) * real
+    struct DualQuat {
+        glm::quat real;
+        glm::quat dual;
+    };
+
+    //运行时检测CPU与操作系统支持的最高指令集
+    SimdLevel    DetectSimdLevel();
+    char const * SimdLevelName(SimdLevel level);
+
+    //每帧只计算一次: 蒙皮矩阵 = 关节全局变换 * 绑定逆矩阵
+    void ComputeSkinningMatrices(
+        Skeleton const &           pose,
+        float                      skeletonScale,
+        std::span<const glm::mat4> invBind,
+        std::vector<glm::mat4> &   skinMats);
+
+    //每帧只计算一次: 关节全局变换与绑定逆矩阵的对偶四元数之积 绑定逆矩阵需为刚体变换
+    void ComputeSkinningDualQuats(
+        Skeleton const &           pose,
+        float                      skeletonScale,
+        std::span<const glm::mat4> invBind,
+        std::vector<DualQuat> &    skinDqs);
+
+    //线性混合蒙皮内核: 绑定姿态的顶点与权重按c_BatchSize个顶点一组以SoA形式存放
+    //关节序号与权重按PackedInfluence16存为uint16 每个影响每顶点读4字节 权重和恰为1
+    //每帧把蒙皮矩阵整理成3x4行主序的调色板 再把批次分块交给线程池
+    //同一份数据也可做对偶四元数混合 每关节8个float 以最大权重的影响为基准翻转反向的四元数
+    class LinearBlendKernel {
+    public:
+        static constexpr std::size_t c_BatchSize = 8;
+
+        //绑定姿态变化或权重重算后调用 给出indices时同时构建法线重算用的顶点-面邻接表
+        //浮点权重先量化为PackedInfluence16 关节序号超过其范围时内核保持为空
+        void Prepare(std::span<const glm::vec3> positions, std::span<const Influence> weights, std::span<const std::uint32_t> indices = {});
+        void Prepare(std::span<const glm::vec3> positions, std::span<const PackedInfluence16> weights, std::span<const std::uint32_t> indices = {});
+        void Prepare(std::span<const glm::vec3> positions, std::span<const PackedInfluence8> weights, std::span<const std::uint32_t> indices = {});
+        void Clear();
+
+        bool        Ready() const { return _count > 0; }
+        std::size_t VertexCount() const { return _count; }
+
+        //level高于DetectSimdLevel()时自动降级
+        SimdLevel Level() const { return _level; }
+        void      SetLevel(SimdLevel level);
+
+        //0表示使用硬件并发数 1为单线程
+        unsigned WorkerCount() const { return _workers; }
+        void     SetWorkerCount(unsigned workers) { _workers = workers; }
+
+        //out.size()需等于VertexCount() skinMats中的下标需覆盖权重引用的所有关节
+        bool Apply(std::span<const glm::mat4> skinMats, std::span<glm::vec3> out) const;
+        bool ApplyDualQuat(std::span<const DualQuat> skinDqs, std::span<glm::vec3> out) const;
+        //Prepare时未给出indices则返回false
+        bool ComputeNormals(std::span<const glm::vec3> positions, std::span<const std::uint32_t> indices, std::span<glm::vec3> normals) const;
+
+    private:
+        template<typename Packed>
+        void PreparePacked(std::span<const glm::vec3> positions, std::span<const Packed> weights, std::span<const std::uint32_t> indices);
+        void ApplyBatches(std::size_t begin, std::size_t end, std::span<glm::vec3> out) const;
+        void ApplyDualQuatBatches(std::size_t begin, std::size_t end, std::span<glm::vec3> out) const;
+
+        std::size_t                _count { 0 };
+        std::size_t                _padded { 0 };
+        std::size_t                _jointLimit { 0 };  //权重引用的最大关节序号+1
+        std::vector<float>         _x, _y, _z;
+        std::vector<std::uint16_t> _joints;            //[k * padded + v]
+        std::vector<std::uint16_t> _weights;           //[k * padded + v] unorm16 缺省影响的权重为0
+        std::vector<std::uint8_t>  _influences;        //每批顶点的最大有效影响数
+        mutable std::vector<float> _palette;           //每关节12个float
+        mutable std::vector<float> _dqPalette;         //每关节8个float: 旋转xyzw 对偶部xyzw
+        SimdLevel                  _level { DetectSimdLevel() };
+        unsigned                   _workers { 0 };
+        VertexFaceAdjacency        _adjacency;
+    };
+
+    //每帧的关节变换缓冲 由调用方持有并跨帧复用 关节数不变时不再分配
+    struct SkinningScratch {
+        std::vector<glm::mat4> skinMats;
+        std::vector<DualQuat>  skinDqs;
+    };
+
+    //蒙皮结果写入调用方持有的positions/normals(大小均需等于kernel.VertexCount()) 拓扑由indices借用 不复制绑定网格
+    //kernel以同一indices Prepare过时并行重算法线 否则逐面散射; scratch与kernel的缓冲预热后每帧没有堆分配
+    bool ApplySkinning(
+        Skeleton const &               pose,
+        float                          skeletonScale,
+        LinearBlendKernel const &      kernel,
+        std::span<const glm::mat4>     invBind,
+        std::span<const std::uint32_t> indices,
+        SkinningMethod                 method,
+        SkinningScratch &              scratch,
+        std::span<glm::vec3>           positions,
+        std::span<glm::vec3>           normals);
+
+    //便捷版本: outMesh复制绑定网格的拓扑与纹理坐标 每帧调用时应改用上面的版本
+    bool ApplySkinning(
+        Engine::SurfaceMesh const &    bindMesh,
+        Skeleton const &               pose,
+        float                          skeletonScale,
+        LinearBlendKernel const &      kernel,
+        std::vector<glm::mat4> const & invBind,
+        Engine::SurfaceMesh &          outMesh,
+        SkinningMethod                 method = SkinningMethod::Linear);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+namespace VCX::Labs::Final::Spring {
+    //半衰期(秒)换算为临界阻尼弹簧的阻尼系数
+    inline float HalflifeToDamping(float halflife) {
+        return (4.0f * 0.69314718056f) / (halflife + 1e-5f);
+    }
+
+    //临界阻尼弹簧: 位置目标为0 精确地推进dt秒
+    template<typename T>
+    void DecaySpringDamperExact(T & x, T & v, float halflife, float dt) {
+        float y = HalflifeToDamping(halflife) / 2.0f;
+        T j1 = v + x * y;
+        float eydt = std::exp(-y * dt);
+        x = (x + j1 * dt) * eydt;
+        v = (v - j1 * (y * dt)) * eydt;
+    }
+
+    //临界阻尼弹簧: 速度目标为v_goal 精确地推进dt秒 用于预测角色的未来轨迹
+    template<typename T>
+    void CharacterUpdate(T & x, T & v, T & a, T const & v_goal, float halflife, float dt) {
+        float y = HalflifeToDamping(halflife) / 2.0f;
+        T j0 = v - v_goal;
+        T j1 = a + j0 * y;
+        float eydt = std::exp(-y * dt);
+        x = (-j1 / (y * y) + (-j0 - j1 * dt) / y) * eydt + j1 / (y * y) + j0 / y + v_goal * dt + x;
+        v = (j0 + j1 * dt) * eydt + v_goal;
+        a = (a - j1 * (y * dt)) * eydt;
+    }
+}
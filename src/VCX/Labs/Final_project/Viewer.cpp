@@ -1,4 +1,5 @@
-﻿#include <filesystem>
+﻿#include <algorithm>
+#include <filesystem>
 
 #include <spdlog/spdlog.h>
 
@@ -14,6 +15,12 @@ namespace VCX::Labs::Final {
                 Engine::GL::SharedShader("assets/shaders/three.geom"),
                 Engine::GL::SharedShader("assets/shaders/three.frag") })),
         _uniformBlock(0, Engine::GL::DrawFrequency::Stream),
+        _skinnedProgram(
+            Engine::GL::UniqueProgram({
+                Engine::GL::SharedShader("assets/shaders/skinned.vert"),
+                Engine::GL::SharedShader("assets/shaders/three.geom"),
+                Engine::GL::SharedShader("assets/shaders/three.frag") })),
+        _paletteBlock(1, Engine::GL::DrawFrequency::Stream),
         _lineProgram(
             Engine::GL::UniqueProgram({
                 Engine::GL::SharedShader("assets/shaders/flat.vert"),
@@ -23,9 +30,11 @@ namespace VCX::Labs::Final {
                 .Add<glm::vec3>("position", Engine::GL::DrawFrequency::Stream, 0),
             Engine::GL::PrimitiveType::Lines) {
         _program.BindUniformBlock("PassConstants", 0);
+        _skinnedProgram.BindUniformBlock("PassConstants", 0);
+        _skinnedProgram.BindUniformBlock("SkinningPalette", 1);
     }
 
-    Common::CaseRenderResult Viewer::Render(RenderOptions const & options, ModelObject & modelObject, Engine::Camera &camera, Engine::ICameraManager & cameraManager, std::pair<std::uint32_t, std::uint32_t> desiredSize, std::span<glm::vec3 const> skeletonLines) {
+    Common::CaseRenderResult Viewer::Render(RenderOptions const & options, ModelObject & modelObject, Engine::Camera &camera, Engine::ICameraManager & cameraManager, std::pair<std::uint32_t, std::uint32_t> desiredSize, std::span<glm::vec3 const> skeletonLines, std::span<glm::mat4 const> skinMats) {
         _frame.Resize(desiredSize);
         gl_using(_frame);
 
@@ -54,7 +63,17 @@ namespace VCX::Labs::Final {
             glEnable(GL_CULL_FACE);
         }
 
-        modelObject.Draw({ _program.Use() });
+        if (modelObject.IsSkinned()) {
+            //每帧只上传用到的关节矩阵
+            std::size_t count = std::min(skinMats.size(), c_MaxPaletteJoints);
+            if (count > 0) {
+                auto const usePalette { _paletteBlock.Use() };
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat4), skinMats.data());
+            }
+            modelObject.Draw({ _skinnedProgram.Use() });
+        } else {
+            modelObject.Draw({ _program.Use() });
+        }
 
         if (! skeletonLines.empty()) {
             _lineProgram.GetUniforms().SetByName("u_Projection", camera.GetProjectionMatrix(float(desiredSize.first) / desiredSize.second));
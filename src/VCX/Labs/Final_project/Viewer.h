@@ -28,6 +28,13 @@ namespace VCX::Labs::Final {
         alignas(4)  int        Flat;
     };
 
+    //skinned.vert中的关节矩阵调色板 保持在UBO最小保证大小(16KB)以内
+    inline constexpr std::size_t c_MaxPaletteJoints = 128;
+
+    struct SkinningPalette {
+        alignas(64) glm::mat4  Joints[c_MaxPaletteJoints];
+    };
+
     struct RenderOptions {
         glm::vec3 LightDirection = glm::vec3(1.f, -1.f, 1.f);
         glm::vec3 LightColor     = glm::vec3(1.f, 1.f, 1.f);
@@ -45,13 +52,16 @@ namespace VCX::Labs::Final {
         auto GetSize() const { return _frame.GetSize(); }
         auto const & GetTexture() { return _frame.GetColorAttachment(); }
 
-        Common::CaseRenderResult Render(RenderOptions const & options, ModelObject & modelObject, Engine::Camera &camera, Engine::ICameraManager & cameraManager, std::pair<std::uint32_t, std::uint32_t> desiredSize, std::span<glm::vec3 const> skeletonLines = {});
+        //modelObject为蒙皮网格时 skinMats为每关节的蒙皮矩阵(关节全局变换 * 绑定逆矩阵) 至多c_MaxPaletteJoints个
+        Common::CaseRenderResult Render(RenderOptions const & options, ModelObject & modelObject, Engine::Camera &camera, Engine::ICameraManager & cameraManager, std::pair<std::uint32_t, std::uint32_t> desiredSize, std::span<glm::vec3 const> skeletonLines = {}, std::span<glm::mat4 const> skinMats = {});
 
         static void SetupRenderOptionsUI(RenderOptions & options, Common::OrbitCameraManager & cameraManager);
 
     private:
         Engine::GL::UniqueProgram                      _program;
         Engine::GL::UniqueUniformBlock<PassConstants>  _uniformBlock;
+        Engine::GL::UniqueProgram                      _skinnedProgram;
+        Engine::GL::UniqueUniformBlock<SkinningPalette> _paletteBlock;
         Engine::GL::UniqueRenderFrame                  _frame;
         Engine::GL::UniqueProgram                      _lineProgram;
         Engine::GL::UniqueRenderItem                   _lineItem;
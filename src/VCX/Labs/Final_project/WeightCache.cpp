@@ -0,0 +1,214 @@
+#include "Labs/Final_project/WeightCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#include "Labs/Final_project/Hash.h"
+#include "Labs/Final_project/MappedFile.h"
+
+namespace VCX::Labs::Final::Skinning {
+namespace {
+    constexpr char          c_Magic[4]         = { 'V', 'C', 'X', 'W' };
+    constexpr std::uint32_t c_Version          = 2;  //权重算法或文件格式变化时递增 使旧缓存失效
+    constexpr std::uint64_t c_SectionAlignment = 64;
+    constexpr float         c_WeightSumEpsilon = 1e-3f;  //归一化后的权重和与1的允许误差
+
+    struct CacheHeader {
+        char          magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t influence_size;   //sizeof(Influence) 不同布局的构建不能共用缓存
+        std::uint32_t matrix_size;
+        std::uint64_t vertex_count;
+        std::uint64_t joint_count;
+        std::uint64_t file_size;
+        std::uint64_t weights_offset;
+        std::uint64_t inv_bind_offset;
+        std::uint64_t checksum;         //计算时本字段置0
+    };
+
+    std::uint64_t AlignUp(std::uint64_t v) {
+        return (v + c_SectionAlignment - 1) / c_SectionAlignment * c_SectionAlignment;
+    }
+
+    void Layout(CacheHeader & h) {
+        std::uint64_t cursor = AlignUp(sizeof(CacheHeader));
+        auto place = [&](std::uint64_t & offset, std::uint64_t bytes) {
+            offset = cursor;
+            cursor = AlignUp(cursor + bytes);
+        };
+        place(h.weights_offset, sizeof(Influence) * h.vertex_count);
+        place(h.inv_bind_offset, sizeof(glm::mat4) * h.joint_count);
+        h.file_size = cursor;
+    }
+
+    //校验头部、权重段与绑定逆矩阵
+    std::uint64_t Checksum(CacheHeader h, std::byte const * base) {
+        h.checksum = 0;
+        Fnv1a64 hash;
+        hash.UpdateValue(h);
+        hash.Update(base + h.weights_offset, sizeof(Influence) * h.vertex_count);
+        hash.Update(base + h.inv_bind_offset, sizeof(glm::mat4) * h.joint_count);
+        return hash.Digest();
+    }
+
+    //关节序号在范围内 权重有限且非负 空槽权重为0 权重和为1(没有任何关节时为0)
+    bool ValidInfluence(Influence const & inf, std::uint64_t jointCount) {
+        float sum = 0.0f;
+        bool  any = false;
+        for (std::size_t k = 0; k < inf.joints.size(); k++) {
+            int   j = inf.joints[k];
+            float w = inf.weights[k];
+            if (j < -1 || j >= static_cast<std::int64_t>(jointCount)) return false;
+            if (! std::isfinite(w) || w < 0.0f || (j < 0 && w != 0.0f)) return false;
+            any = any || j >= 0;
+            sum += w;
+        }
+        return any ? std::fabs(sum - 1.0f) <= c_WeightSumEpsilon : sum == 0.0f;
+    }
+} // namespace
+
+    std::uint64_t WeightCacheKey(
+        Engine::SurfaceMesh const & bindMesh,
+        Skeleton const &            bindPose,
+        float                       skeletonScale,
+        Options const &             options) {
+        Fnv1a64 hash;
+        auto update = [&hash]<typename T>(std::vector<T> const & values) {
+            hash.UpdateValue(values.size());
+            hash.Update(values.data(), sizeof(T) * values.size());
+        };
+        update(bindMesh.Positions);
+        update(bindMesh.Indices);
+        update(bindPose.parents);
+        update(bindPose.global_trans);
+        update(bindPose.global_rot);
+        hash.UpdateValue(skeletonScale);
+        hash.UpdateValue(options.diffusion);
+        hash.UpdateValue(options.heatIterations);
+        hash.UpdateValue(options.heatLambda);
+        hash.UpdateValue(options.heatAnchorRadius);
+        hash.UpdateValue(options.componentMaxJoints);
+        return hash.Digest();
+    }
+
+    std::filesystem::path WeightCachePath(std::filesystem::path const & directory, std::uint64_t key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.vcxw", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+
+    bool LoadWeightCache(
+        std::filesystem::path const & directory,
+        std::uint64_t                 key,
+        std::size_t                   vertexCount,
+        std::vector<Influence> &      weights,
+        std::vector<glm::mat4> &      invBind) {
+        auto file = MappedFile::Open(WeightCachePath(directory, key));
+        if (! file) return false;
+        auto bytes = file->Bytes();
+        if (bytes.size() < sizeof(CacheHeader)) return false;
+
+        CacheHeader h;
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (std::memcmp(h.magic, c_Magic, sizeof(c_Magic)) != 0 || h.version != c_Version || h.key != key) return false;
+        if (h.influence_size != sizeof(Influence) || h.matrix_size != sizeof(glm::mat4)) return false;
+        if (h.vertex_count != vertexCount || h.joint_count == 0) return false;
+
+        CacheHeader expected = h;
+        Layout(expected);
+        if (std::memcmp(&expected, &h, sizeof(h)) != 0 || h.file_size != bytes.size()) return false;
+        if (Checksum(h, bytes.data()) != h.checksum) return false;
+
+        std::vector<Influence> loaded(h.vertex_count);
+        std::memcpy(loaded.data(), bytes.data() + h.weights_offset, sizeof(Influence) * h.vertex_count);
+        for (auto const & inf : loaded)
+            if (! ValidInfluence(inf, h.joint_count)) return false;
+        invBind.resize(h.joint_count);
+        std::memcpy(invBind.data(), bytes.data() + h.inv_bind_offset, sizeof(glm::mat4) * h.joint_count);
+        weights = std::move(loaded);
+
+        //命中时更新修改时间 淘汰按修改时间从旧到新进行 失败不影响本次结果
+        file.reset();
+        std::error_code ec;
+        std::filesystem::last_write_time(WeightCachePath(directory, key), std::filesystem::file_time_type::clock::now(), ec);
+        return true;
+    }
+
+    void TrimWeightCache(std::filesystem::path const & directory, std::size_t maxFiles, std::uint64_t maxBytes) {
+        struct Entry {
+            std::filesystem::path           path;
+            std::filesystem::file_time_type time;
+            std::uint64_t                   size;
+        };
+        std::vector<Entry> entries;
+        std::error_code    ec;
+        for (std::filesystem::directory_iterator it(directory, ec), end; ! ec && it != end; it.increment(ec)) {
+            std::error_code entry_ec;
+            if (it->path().extension() != ".vcxw" || ! it->is_regular_file(entry_ec)) continue;
+            auto time = it->last_write_time(entry_ec);
+            auto size = it->file_size(entry_ec);
+            if (entry_ec) continue;
+            entries.push_back({ it->path(), time, size });
+        }
+        std::sort(entries.begin(), entries.end(), [](Entry const & a, Entry const & b) { return a.time > b.time; });
+
+        //保留最新的文件 即使它单独超过上限
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            total += entries[i].size;
+            if (i == 0 || (i < maxFiles && total <= maxBytes)) continue;
+            std::filesystem::remove(entries[i].path, ec);  //被其他进程占用时跳过
+        }
+    }
+
+    bool SaveWeightCache(
+        std::filesystem::path const & directory,
+        std::uint64_t                 key,
+        std::span<const Influence>    weights,
+        std::span<const glm::mat4>    invBind) {
+        if (weights.empty() || invBind.empty()) return false;
+
+        CacheHeader h {};
+        std::memcpy(h.magic, c_Magic, sizeof(c_Magic));
+        h.version = c_Version;
+        h.key = key;
+        h.influence_size = sizeof(Influence);
+        h.matrix_size = sizeof(glm::mat4);
+        h.vertex_count = weights.size();
+        h.joint_count = invBind.size();
+        Layout(h);
+
+        std::vector<std::byte> buffer(h.file_size, std::byte { 0 });
+        std::byte * base = buffer.data();
+        std::memcpy(base + h.weights_offset, weights.data(), weights.size_bytes());
+        std::memcpy(base + h.inv_bind_offset, invBind.data(), invBind.size_bytes());
+        h.checksum = Checksum(h, base);
+        std::memcpy(base, &h, sizeof(h));
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) return false;
+        //先写临时文件再替换 避免其他进程映射到写了一半的缓存
+        auto path = WeightCachePath(directory, key);
+        auto tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (! file) return false;
+            file.write(reinterpret_cast<char const *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            if (! file) return false;
+        }
+        std::filesystem::rename(tmp, path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        TrimWeightCache(directory);
+        return true;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "Labs/Final_project/Skinning.h"
+
+namespace VCX::Labs::Final::Skinning {
+    //二进制蒙皮权重缓存(.vcxw) 依次为: 文件头、Influence数组、绑定逆矩阵 各段按64字节对齐
+    //以绑定网格的顶点与索引、骨骼绑定姿态、skeletonScale与Options(workerCount除外)的内容哈希为键
+    //文件名即为键 文件头再记录一遍键 版本、键、数量或整个文件的校验和不符时视为失效
+    std::uint64_t WeightCacheKey(
+        Engine::SurfaceMesh const & bindMesh,
+        Skeleton const &            bindPose,
+        float                       skeletonScale,
+        Options const &             options);
+
+    std::filesystem::path WeightCachePath(std::filesystem::path const & directory, std::uint64_t key);
+
+    //映射缓存文件并拷出权重 文件不存在或失效时返回false且不修改输出
+    //权重需有限、非负且和为1 否则同样视为失效; 命中时更新文件的修改时间供淘汰使用
+    bool LoadWeightCache(
+        std::filesystem::path const & directory,
+        std::uint64_t                 key,
+        std::size_t                   vertexCount,
+        std::vector<Influence> &      weights,
+        std::vector<glm::mat4> &      invBind);
+
+    //目录不存在时自动创建 写入后调用TrimWeightCache
+    bool SaveWeightCache(
+        std::filesystem::path const & directory,
+        std::uint64_t                 key,
+        std::span<const Influence>    weights,
+        std::span<const glm::mat4>    invBind);
+
+    //按修改时间从新到旧保留不超过maxFiles个、总大小不超过maxBytes的.vcxw文件 其余删除(LRU)
+    //最新的文件总会保留 删除失败(如被其他进程映射)时跳过
+    void TrimWeightCache(
+        std::filesystem::path const & directory,
+        std::size_t                   maxFiles = 32,
+        std::uint64_t                 maxBytes = 256ull << 20);
+}